@@ -0,0 +1,60 @@
+#include "ai.h"
+#include "pool.h"
+#include "rng.h"
+#include <chthon/game.h>
+#include <chthon/level.h>
+#include <chthon/actions.h>
+#include <cstdlib>
+#include <list>
+using namespace Chthon;
+
+TempleAI::TempleAI(Rng & ai_random)
+	: random(ai_random), behaviours(0)
+{
+}
+
+TempleAI * TempleAI::add(int behaviour)
+{
+	behaviours |= behaviour;
+	return this;
+}
+
+static bool is_seen_by_player(const Level & level, const Monster & monster, const Monster & player)
+{
+	return level.map.valid(monster.pos) && level.map.cell(monster.pos).visible
+		&& distance(monster.pos, player.pos) <= monster.type->sight;
+}
+
+// First step of the way to a player who is already known to be seen;
+// none if there is no way.
+Action * TempleAI::chase(const Level & level, const Monster & monster, const Monster & player) const
+{
+	std::list<Point> path = level.find_path(monster.pos, player.pos);
+	if(path.empty()) {
+		return nullptr;
+	}
+	return new Pooled<Move>(path.front());
+}
+
+Action * TempleAI::act(Monster & monster, Game & game)
+{
+	const Level & level = game.current_level();
+	const Monster & player = level.get_player();
+	if(player.valid()) {
+		Point shift(player.pos.x - monster.pos.x, player.pos.y - monster.pos.y);
+		bool is_near = abs(shift.x) <= 1 && abs(shift.y) <= 1;
+		if((behaviours & HIT_PLAYER_IF_NEAR) && is_near) {
+			return new Pooled<Swing>(shift);
+		}
+		if((behaviours & MOVE_TO_HIT_PLAYER_IF_SEES) && is_seen_by_player(level, monster, player)) {
+			Action * step = chase(level, monster, player);
+			if(step) {
+				return step;
+			}
+		}
+	}
+	if(behaviours & MOVE_RANDOM) {
+		return new Pooled<Move>(Point(random.range(-1, 1), random.range(-1, 1)));
+	}
+	return new Pooled<Wait>();
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <chthon/ai.h>
+class Rng;
+namespace Chthon {
+	class Action;
+	class Monster;
+	class Game;
+	class Level;
+}
+
+// Temple monsters: chase the player they see, otherwise wander or wait.
+// Whether a monster sees the player is taken from player's FOV (already
+// computed by Chthon): sight is symmetric, so one FOV answers for all
+// monsters at once and no monster runs line of sight checks of its own.
+// Monster which sees the player but has no way to them wanders on.
+// Random steps are drawn from the game's Rng instead of global rand().
+class TempleAI : public Chthon::Controller {
+public:
+	enum {
+		MOVE_TO_HIT_PLAYER_IF_SEES = 1 << 0,
+		HIT_PLAYER_IF_NEAR = 1 << 1,
+		MOVE_RANDOM = 1 << 2,
+		WAIT = 1 << 3
+	};
+	TempleAI(Rng & ai_random);
+	virtual ~TempleAI() {}
+	TempleAI * add(int behaviour);
+	virtual Chthon::Action * act(Chthon::Monster & monster, Chthon::Game & game);
+private:
+	Rng & random;
+	int behaviours;
+	Chthon::Action * chase(const Chthon::Level & level, const Chthon::Monster & monster, const Chthon::Monster & player) const;
+};
@@ -0,0 +1,361 @@
+#include "backend.h"
+#include <ncurses.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+
+enum { ESCAPE_DELAY = 25 };
+
+NCursesBackend::NCursesBackend()
+	: is_initialized(false)
+{
+}
+
+void NCursesBackend::init()
+{
+	if(is_initialized) {
+		return;
+	}
+	is_initialized = true;
+	initscr();
+	raw();
+	keypad(stdscr, TRUE);
+	noecho();
+	curs_set(0);
+	start_color();
+	set_escdelay(ESCAPE_DELAY);
+
+	for(short fore = 0; fore < 8; ++fore) {
+		if(fore == 0) {
+			continue;
+		}
+		init_pair(fore, fore, 0);
+	}
+}
+
+NCursesBackend::~NCursesBackend()
+{
+	if(!is_initialized) {
+		return;
+	}
+	cbreak();
+	echo();
+	curs_set(1);
+	endwin();
+}
+
+unsigned NCursesBackend::width() const
+{
+	return unsigned(getmaxx(stdscr));
+}
+
+unsigned NCursesBackend::height() const
+{
+	return unsigned(getmaxy(stdscr));
+}
+
+void NCursesBackend::put_glyph(int x, int y, const Glyph & glyph)
+{
+	chtype value = COLOR_PAIR(int(glyph.color()));
+	value |= glyph.ch;
+	if(glyph.attrs & Glyph::BOLD) {
+		value |= A_BOLD;
+	}
+	if(glyph.attrs & Glyph::BLINK) {
+		value |= A_BLINK;
+	}
+	mvaddch(y, x, value);
+}
+
+void NCursesBackend::put_text(int x, int y, const std::string & text)
+{
+	mvprintw(y, x, "%s", text.c_str());
+}
+
+Glyph NCursesBackend::get_glyph(int x, int y) const
+{
+	int cursor_x, cursor_y;
+	getyx(stdscr, cursor_y, cursor_x);
+	chtype value = mvinch(y, x);
+	move(cursor_y, cursor_x);
+	unsigned attrs = unsigned(PAIR_NUMBER(int(value & A_COLOR))) & Glyph::COLOR_MASK;
+	if(value & A_BOLD) {
+		attrs |= Glyph::BOLD;
+	}
+	if(value & A_BLINK) {
+		attrs |= Glyph::BLINK;
+	}
+	return Glyph((unsigned char)(value & A_CHARTEXT), attrs);
+}
+
+void NCursesBackend::clear()
+{
+	::erase();
+}
+
+void NCursesBackend::refresh()
+{
+	::refresh();
+}
+
+void NCursesBackend::show_cursor(bool visible)
+{
+	curs_set(visible ? 1 : 0);
+}
+
+void NCursesBackend::move_cursor(int x, int y)
+{
+	move(y, x);
+}
+
+int NCursesBackend::get_key(int timeout)
+{
+	if(timeout >= 0) {
+		wtimeout(stdscr, timeout);
+	}
+	int ch = getch();
+	if(timeout >= 0) {
+		wtimeout(stdscr, -1);
+	}
+	return (ch == ERR) ? NO_KEY : ch;
+}
+
+
+FramebufferBackend::FramebufferBackend(unsigned width, unsigned height)
+	: frames(0), fb_width(width), fb_height(height), cells(width * height),
+	cursor_x(0), cursor_y(0), cursor_visible(false), changed(true)
+{
+}
+
+unsigned FramebufferBackend::width() const
+{
+	return fb_width;
+}
+
+unsigned FramebufferBackend::height() const
+{
+	return fb_height;
+}
+
+bool FramebufferBackend::valid(int x, int y) const
+{
+	return 0 <= x && x < int(fb_width) && 0 <= y && y < int(fb_height);
+}
+
+void FramebufferBackend::put_glyph(int x, int y, const Glyph & glyph)
+{
+	if(valid(x, y)) {
+		cells[unsigned(x) + unsigned(y) * fb_width] = glyph;
+		changed = true;
+	}
+}
+
+void FramebufferBackend::put_text(int x, int y, const std::string & text)
+{
+	for(unsigned i = 0; i < text.size(); ++i) {
+		put_glyph(x + int(i), y, Glyph((unsigned char)text[i]));
+	}
+}
+
+Glyph FramebufferBackend::get_glyph(int x, int y) const
+{
+	if(valid(x, y)) {
+		return cells[unsigned(x) + unsigned(y) * fb_width];
+	}
+	return Glyph();
+}
+
+void FramebufferBackend::clear()
+{
+	cells.assign(cells.size(), Glyph());
+	changed = true;
+}
+
+void FramebufferBackend::refresh()
+{
+	++frames;
+	changed = false;
+}
+
+void FramebufferBackend::show_cursor(bool visible)
+{
+	cursor_visible = visible;
+	changed = true;
+}
+
+void FramebufferBackend::move_cursor(int x, int y)
+{
+	cursor_x = x;
+	cursor_y = y;
+	changed = true;
+}
+
+int FramebufferBackend::get_key(int timeout)
+{
+	if(keys.empty()) {
+		if(timeout < 0) {
+			throw Hangup();
+		}
+		return NO_KEY;
+	}
+	int ch = keys.front();
+	keys.pop_front();
+	return ch;
+}
+
+std::string FramebufferBackend::row(int y) const
+{
+	std::string result;
+	for(int x = 0; x < int(fb_width); ++x) {
+		result += char(get_glyph(x, y).ch);
+	}
+	return result;
+}
+
+std::string FramebufferBackend::dump() const
+{
+	std::string result;
+	for(int y = 0; y < int(fb_height); ++y) {
+		result += row(y) + '\n';
+	}
+	return result;
+}
+
+
+struct AnsiBackend::TermiosState {
+	struct termios value;
+};
+
+static unsigned terminal_size(int fd, bool get_width)
+{
+	struct winsize size;
+	if(isatty(fd) && ioctl(fd, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 && size.ws_row > 0) {
+		return get_width ? size.ws_col : size.ws_row;
+	}
+	return get_width ? 80 : 24;
+}
+
+AnsiBackend::AnsiBackend(int input_fd, int output_fd)
+	: FramebufferBackend(terminal_size(output_fd, true), terminal_size(output_fd, false)),
+	in_fd(input_fd), out_fd(output_fd), raw_mode(false), shown_cursor_visible(false),
+	saved_termios(nullptr)
+{
+	if(isatty(in_fd)) {
+		saved_termios = new TermiosState;
+		if(tcgetattr(in_fd, &saved_termios->value) == 0) {
+			struct termios raw = saved_termios->value;
+			cfmakeraw(&raw);
+			raw_mode = tcsetattr(in_fd, TCSANOW, &raw) == 0;
+		}
+	}
+	shown.assign(cells.size(), Glyph('\0'));
+	write_all("\033[?25l\033[0m\033[2J");
+}
+
+AnsiBackend::~AnsiBackend()
+{
+	char buffer[48];
+	snprintf(buffer, sizeof(buffer), "\033[0m\033[%u;1H\033[?25h\r\n", fb_height);
+	write_all(buffer);
+	if(raw_mode) {
+		tcsetattr(in_fd, TCSANOW, &saved_termios->value);
+	}
+	delete saved_termios;
+}
+
+bool AnsiBackend::write_all(const std::string & data)
+{
+	size_t written = 0;
+	while(written < data.size()) {
+		ssize_t result = write(out_fd, data.data() + written, data.size() - written);
+		if(result < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		written += size_t(result);
+	}
+	return true;
+}
+
+void AnsiBackend::refresh()
+{
+	FramebufferBackend::refresh();
+	output.clear();
+	char buffer[48];
+	int last_attrs = -1;
+	int next_x = -1, next_y = -1;
+	for(int y = 0; y < int(fb_height); ++y) {
+		for(int x = 0; x < int(fb_width); ++x) {
+			unsigned index = unsigned(x) + unsigned(y) * fb_width;
+			const Glyph & glyph = cells[index];
+			if(glyph == shown[index]) {
+				continue;
+			}
+			if(x != next_x || y != next_y) {
+				snprintf(buffer, sizeof(buffer), "\033[%d;%dH", y + 1, x + 1);
+				output += buffer;
+			}
+			if(int(glyph.attrs) != last_attrs) {
+				output += "\033[0";
+				if(glyph.color() != Color::BLACK) {
+					snprintf(buffer, sizeof(buffer), ";%u", 30 + glyph.color());
+					output += buffer;
+				}
+				if(glyph.attrs & Glyph::BOLD) {
+					output += ";1";
+				}
+				if(glyph.attrs & Glyph::BLINK) {
+					output += ";5";
+				}
+				output += 'm';
+				last_attrs = glyph.attrs;
+			}
+			output += char(glyph.ch >= ' ' ? glyph.ch : ' ');
+			shown[index] = glyph;
+			next_x = x + 1;
+			next_y = y;
+		}
+	}
+	if(cursor_visible) {
+		snprintf(buffer, sizeof(buffer), "\033[%d;%dH\033[?25h", cursor_y + 1, cursor_x + 1);
+		output += buffer;
+	} else if(!output.empty() || shown_cursor_visible) {
+		output += "\033[?25l";
+	}
+	shown_cursor_visible = cursor_visible;
+	if(!output.empty()) {
+		write_all(output);
+	}
+}
+
+int AnsiBackend::get_key(int timeout)
+{
+	if(changed) {
+		refresh();
+	}
+	struct pollfd input;
+	input.fd = in_fd;
+	input.events = POLLIN;
+	input.revents = 0;
+	int ready = poll(&input, 1, timeout);
+	if(ready < 0 && errno == EINTR) {
+		return NO_KEY;
+	}
+	if(ready == 0) {
+		return NO_KEY;
+	}
+	unsigned char ch = 0;
+	ssize_t result = (ready > 0) ? read(in_fd, &ch, 1) : -1;
+	if(result == 1) {
+		return ch;
+	}
+	if(result < 0 && errno == EINTR) {
+		return NO_KEY;
+	}
+	throw Hangup();
+}
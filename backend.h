@@ -0,0 +1,120 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+
+namespace Color {
+enum { BLACK, RED, GREEN, YELLOW, BLUE, MAGENTA, CYAN, WHITE, COUNT };
+}
+
+struct Glyph {
+	enum { COLOR_MASK = 0x07, BOLD = 0x08, BLINK = 0x10 };
+	unsigned char ch;
+	unsigned char attrs;
+	Glyph(unsigned char glyph_ch = ' ', unsigned glyph_attrs = 0)
+		: ch(glyph_ch), attrs((unsigned char)glyph_attrs) {}
+	unsigned color() const { return attrs & COLOR_MASK; }
+	bool operator==(const Glyph & other) const { return ch == other.ch && attrs == other.attrs; }
+	bool operator!=(const Glyph & other) const { return !(*this == other); }
+};
+
+// Terminal abstraction: everything Console draws or reads goes through it.
+// Drawing happens into a back buffer which is shown on refresh().
+// Like curses getch(), get_key() flushes pending output before reading.
+// It waits up to timeout milliseconds for a key (forever if negative) and
+// returns NO_KEY if there is none. Blocking get_key() throws Hangup when
+// input is gone for good.
+// Terminal is set up by init() rather than by constructor, so that slow
+// setup may overlap with other startup work. It must be called once
+// before anything else.
+class Backend {
+public:
+	enum { NO_KEY = -1, KEY_ESCAPE = 27 };
+	enum { WAIT_FOREVER = -1 };
+	struct Hangup {};
+	virtual ~Backend() {}
+	virtual void init() {}
+	virtual unsigned width() const = 0;
+	virtual unsigned height() const = 0;
+	virtual void put_glyph(int x, int y, const Glyph & glyph) = 0;
+	virtual void put_text(int x, int y, const std::string & text) = 0;
+	virtual Glyph get_glyph(int x, int y) const = 0;
+	virtual void clear() = 0;
+	virtual void refresh() = 0;
+	virtual void show_cursor(bool visible) = 0;
+	virtual void move_cursor(int x, int y) = 0;
+	virtual int get_key(int timeout = WAIT_FOREVER) = 0;
+};
+
+class NCursesBackend : public Backend {
+public:
+	NCursesBackend();
+	virtual ~NCursesBackend();
+	virtual void init();
+	virtual unsigned width() const;
+	virtual unsigned height() const;
+	virtual void put_glyph(int x, int y, const Glyph & glyph);
+	virtual void put_text(int x, int y, const std::string & text);
+	virtual Glyph get_glyph(int x, int y) const;
+	virtual void clear();
+	virtual void refresh();
+	virtual void show_cursor(bool visible);
+	virtual void move_cursor(int x, int y);
+	virtual int get_key(int timeout = WAIT_FOREVER);
+private:
+	bool is_initialized;
+};
+
+// Offscreen backend: renders into memory, reads keys from a scripted queue.
+// Useful for benchmarks, tests and golden-frame comparisons.
+// Running out of scripted keys counts as a hangup.
+class FramebufferBackend : public Backend {
+public:
+	std::deque<int> keys;
+	unsigned frames;
+
+	FramebufferBackend(unsigned fb_width = 80, unsigned fb_height = 24);
+	virtual ~FramebufferBackend() {}
+	virtual unsigned width() const;
+	virtual unsigned height() const;
+	virtual void put_glyph(int x, int y, const Glyph & glyph);
+	virtual void put_text(int x, int y, const std::string & text);
+	virtual Glyph get_glyph(int x, int y) const;
+	virtual void clear();
+	virtual void refresh();
+	virtual void show_cursor(bool visible);
+	virtual void move_cursor(int x, int y);
+	virtual int get_key(int timeout = WAIT_FOREVER);
+
+	const std::vector<Glyph> & screen() const { return cells; }
+	std::string row(int y) const;
+	std::string dump() const;
+protected:
+	unsigned fb_width, fb_height;
+	std::vector<Glyph> cells;
+	int cursor_x, cursor_y;
+	bool cursor_visible;
+	// Something was drawn since the last refresh().
+	bool changed;
+	bool valid(int x, int y) const;
+};
+
+// Raw terminal backend: keeps the frame in memory and emits only changed
+// cells as ANSI escape sequences, one buffered write() per frame.
+// Polling get_key() refreshes only if something was drawn since last frame.
+class AnsiBackend : public FramebufferBackend {
+public:
+	AnsiBackend(int input_fd, int output_fd);
+	virtual ~AnsiBackend();
+	virtual void refresh();
+	virtual int get_key(int timeout = WAIT_FOREVER);
+private:
+	int in_fd, out_fd;
+	bool raw_mode;
+	bool shown_cursor_visible;
+	std::vector<Glyph> shown;
+	std::string output;
+	struct TermiosState;
+	TermiosState * saved_termios;
+	bool write_all(const std::string & data);
+};
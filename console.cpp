@@ -1,64 +1,44 @@
 #include "console.h"
+#include "backend.h"
 #include "sprites.h"
+#include "stacks.h"
 #include <chthon/game.h>
 #include <chthon/level.h>
 #include <chthon/info.h>
 #include <chthon/point.h>
 #include <chthon/log.h>
-#include <ncurses.h>
 #include <map>
+#include <algorithm>
 using namespace Chthon;
 
-std::map<int, Point> Console::directions;
-
 enum {
 	MAP_WIDTH = 60,
 	MAP_HEIGHT = 1 + 23
 };
 
-Console::Console()
-	: messages_seen(0), log_messages(false)
+Console::Console(Backend & console_backend)
+	: messages_seen(0), log_messages(false), view_x(0), view_y(0), stacks(nullptr), backend(console_backend), event_loop(console_backend)
 {
-	initscr();
-	raw();
-	keypad(stdscr, TRUE);
-	noecho();
-	curs_set(0);
-	start_color();
-	
-	for(short fore = 0; fore < 8; ++fore) {
-		if(fore == 0) {
-			continue;
-		}
-		init_pair(fore, fore, 0);
-	}
-
-	if(directions.empty()) {
-		directions['h'] = Point(-1,  0);
-		directions['j'] = Point( 0, +1);
-		directions['k'] = Point( 0, -1);
-		directions['l'] = Point(+1,  0);
-		directions['y'] = Point(-1, -1);
-		directions['u'] = Point(+1, -1);
-		directions['b'] = Point(-1, +1);
-		directions['n'] = Point(+1, +1);
-	}
+	directions['h'] = Point(-1,  0);
+	directions['j'] = Point( 0, +1);
+	directions['k'] = Point( 0, -1);
+	directions['l'] = Point(+1,  0);
+	directions['y'] = Point(-1, -1);
+	directions['u'] = Point(+1, -1);
+	directions['b'] = Point(-1, +1);
+	directions['n'] = Point(+1, +1);
+	names.push_back(std::string());
 }
 
 Console::~Console()
 {
-	cbreak();
-	echo();
-	curs_set(1);
-	endwin();
 }
 
 void Console::print_tile(int x, int y, int sprite, bool with_color)
 {
 	if(sprites.count(sprite) > 0) {
-		chtype value = sprites[sprite].first;
-		chtype color = with_color ? sprites[sprite].second : 0;
-		mvaddch(y, x,  value | color);
+		const Glyph & glyph = sprites[sprite];
+		backend.put_glyph(x, y, with_color ? glyph : Glyph(glyph.ch));
 	} else {
 		log("Unknown sprite with code {0} at ({1}, {2})", sprite, x, y);
 	}
@@ -66,22 +46,22 @@ void Console::print_tile(int x, int y, int sprite, bool with_color)
 
 void Console::print_text(int x, int y, const std::string & text)
 {
-	mvprintw(y, x, "%s", text.c_str());
+	backend.put_text(x, y, text);
 }
 
 void Console::print_stat(int row, const std::string & text)
 {
-	mvprintw(row, MAP_WIDTH, "%s", text.c_str());
+	backend.put_text(MAP_WIDTH, row, text);
 }
 
 void Console::clear()
 {
-	::erase();
+	backend.clear();
 }
 
 int Console::get_control()
 {
-	return getch();
+	return event_loop.get_key();
 }
 
 void Console::set_notification(const std::string & text)
@@ -89,25 +69,45 @@ void Console::set_notification(const std::string & text)
 	notification = text;
 }
 
-struct NCursesUpdate {
-	NCursesUpdate() { erase(); }
-	~NCursesUpdate() { refresh(); }
+struct FrameUpdate {
+	Backend & backend;
+	FrameUpdate(Backend & frame_backend) : backend(frame_backend) { backend.clear(); }
+	~FrameUpdate() { backend.refresh(); }
 };
 
 void Console::print_notification()
 {
-	mvprintw(0, 0, "%s", notification.c_str());
+	backend.put_text(0, 0, notification);
 	notification.clear();
 }
 
+// Scrolls view by half a window when focus gets out of it.
+static int scroll_view(int view, int focus, unsigned window_size, unsigned map_size)
+{
+	if(map_size <= window_size) {
+		return 0;
+	}
+	if(focus < view || focus >= view + int(window_size)) {
+		view = focus - int(window_size) / 2;
+	}
+	return std::max(0, std::min(view, int(map_size - window_size)));
+}
+
+void Console::update_view(const Window & window, const Level & level, const Point & focus)
+{
+	view_x = scroll_view(view_x, focus.x, window.width, level.map.width);
+	view_y = scroll_view(view_y, focus.y, window.height, level.map.height);
+}
+
 void Console::print_map(const Window & window, const Level & level)
 {
-	for(int x = 0; x < int(level.map.width) && (x < int(window.width) - window.x); ++x) {
-		for(int y = 0; y < int(level.map.height) && (y < int(window.height) - window.y); ++y) {
-			if(level.map.cell(x, y).visible) {
-				print_tile(window.x + x, window.y + y, level.get_info(Point(x, y)).compiled().sprite, true);
-			} else if(level.map.cell(x, y).seen_sprite) {
-				print_tile(window.x + x, window.y + y, level.map.cell(x, y).seen_sprite, false);
+	for(int x = 0; x + view_x < int(level.map.width) && x < int(window.width); ++x) {
+		for(int y = 0; y + view_y < int(level.map.height) && y < int(window.height); ++y) {
+			int map_x = x + view_x, map_y = y + view_y;
+			if(level.map.cell(map_x, map_y).visible) {
+				print_tile(window.x + x, window.y + y, level.get_info(Point(map_x, map_y)).compiled().sprite, true);
+			} else if(level.map.cell(map_x, map_y).seen_sprite) {
+				print_tile(window.x + x, window.y + y, level.map.cell(map_x, map_y).seen_sprite, false);
 			}
 		}
 	}
@@ -122,7 +122,7 @@ void Console::print_messages(const Window & window)
 			unsigned messages_left = messages.size() - messages_seen;
 			unsigned messages_to_draw = std::min(messages_left, window.height);
 			for(unsigned i = 0; i < messages_to_draw; ++i) {
-				const std::string & current_message = messages[messages_seen + i];
+				std::string current_message = message_text(messages_seen + i);
 				if(messages_to_draw < messages_left && i == messages_to_draw - 1) {
 					print_text(0, window.y + int(i), current_message + " (...)");
 				} else {
@@ -136,13 +136,19 @@ void Console::print_messages(const Window & window)
 
 void Console::draw_game(const Game & game)
 {
-	NCursesUpdate upd;
+	const Monster & player = game.current_level().get_player();
+	draw_game(game, player.valid() ? player.pos : Point(view_x, view_y));
+}
+
+void Console::draw_game(const Game & game, const Point & focus)
+{
+	FrameUpdate upd(backend);
 
-	Window map_window(0, 1, 60, 23);
+	Window map_window(0, 1, MAP_WIDTH, MAP_HEIGHT - 1);
+	update_view(map_window, game.current_level(), focus);
 	print_map(map_window, game.current_level());
 
-	unsigned width, height;
-	getmaxyx(stdscr, height, width);
+	unsigned width = backend.width(), height = backend.height();
 	int message_pan_top = map_window.y + int(map_window.height);
 	unsigned message_pan_height = (0 <= message_pan_top) ? height - unsigned(message_pan_top) : height;
 	Window message_window(0, message_pan_top, width, message_pan_height);
@@ -172,7 +178,7 @@ Point Console::target_mode(Game & game, const Point & start)
 {
 	Point target = start;
 	int ch = 0;
-	curs_set(1);
+	backend.show_cursor(true);
 	while(ch != 'x' && ch != 27 && ch != '.') {
 		if(game.current_level().map.valid(target)) {
 			if(game.current_level().map.cell(target).visible) {
@@ -183,21 +189,17 @@ Point Console::target_mode(Game & game, const Point & start)
 				set_notification("You cannot see there.");
 			}
 		}
-		draw_game(game);
+		draw_game(game, target);
 		if(game.current_level().map.valid(target)) {
-			int chh = mvinch(target.y + 1, target.x);
-			mvaddch(target.y + 1, target.x, chh ^ A_BLINK);
-			move(target.y + 1, target.x);
+			int screen_x = target.x - view_x, screen_y = target.y - view_y + 1;
+			Glyph glyph = backend.get_glyph(screen_x, screen_y);
+			glyph.attrs ^= Glyph::BLINK;
+			backend.put_glyph(screen_x, screen_y, glyph);
+			backend.move_cursor(screen_x, screen_y);
 		}
 		ch = get_control();
-		if(ch == 27) {
-			nodelay(stdscr, TRUE);
-			ch = getch();
-			nodelay(stdscr, FALSE);
-			if(ch == ERR || ch == 27) {
-				ch = 27;
-				break;
-			}
+		if(ch == Backend::KEY_ESCAPE) {
+			break;
 		}
 
 		if(directions.count(ch) != 0) {
@@ -207,7 +209,7 @@ Point Console::target_mode(Game & game, const Point & start)
 			}
 		}
 	}
-	curs_set(0);
+	backend.show_cursor(false);
 	if(ch == '.') {
 		if(game.current_level().map.cell(target).seen_sprite == 0) {
 			set_notification("You don't know how to get there.");
@@ -256,23 +258,29 @@ int Console::see_messages(Game & game)
 void Console::draw_inventory(const Game &, const Monster & monster)
 {
 	clear();
-	int width, height;
-	getmaxyx(stdscr, height, width);
-	(void)height;
+	int width = int(backend.width());
 	int pos = 0;
 	unsigned index = 0;
 	foreach(const Item & item, monster.inventory.items) {
-		if(item.valid()) {
+		std::vector<unsigned> stack;
+		if(item.valid() && stacks) {
+			stack = stacks->stack_slots(monster.inventory, index);
+		}
+		bool is_stacked_above = !stack.empty() && *std::min_element(stack.begin(), stack.end()) < index;
+		if(item.valid() && !is_stacked_above) {
 			int x = (pos < 13) ? 0 : width / 2;
 			int y = 1 + ((pos < 13) ? pos : pos - 13);
 			std::string text = format("{0} - {1}", char(index + 'a'), item.type->name);
+			if(stack.size() > 1) {
+				text += format(" (x{0})", stack.size());
+			}
 			if(monster.inventory.wields(index)) {
 				text += " (wielded)";
 			}
 			if(monster.inventory.wears(index)) {
 				text += " (worn)";
 			}
-			mvprintw(y, x, text.c_str());
+			backend.put_text(x, y, text);
 			++pos;
 		}
 		++index;
@@ -282,29 +290,28 @@ void Console::draw_inventory(const Game &, const Monster & monster)
 	}
 }
 
+void Console::draw_text(const std::vector<std::string> & lines)
+{
+	clear();
+	for(unsigned i = 0; i < lines.size() && i < backend.height(); ++i) {
+		print_text(0, int(i), lines[i]);
+	}
+}
+
 unsigned Console::get_inventory_slot(const Game & game, const Monster & monster)
 {
 	draw_inventory(game, monster);
 
-	unsigned width, height;
-	getmaxyx(stdscr, height, width);
-	(void)height;
+	unsigned width = backend.width();
 	unsigned slot = Inventory::NOTHING;
 	while(true) {
-		mvprintw(0, 0, "%s", std::string(width, ' ').c_str());
+		backend.put_text(0, 0, std::string(width, ' '));
 		print_notification();
 
-		int ch = getch();
-		if(ch == 27) {
-			nodelay(stdscr, TRUE);
-			ch = getch();
-			nodelay(stdscr, FALSE);
-			if(ch == ERR || ch == 27) {
-				slot = Inventory::NOTHING;
-				break;
-			}
-			set_notification("This is not a slot");
-			continue;
+		int ch = get_control();
+		if(ch == Backend::KEY_ESCAPE) {
+			slot = Inventory::NOTHING;
+			break;
 		}
 		if(ch < 'a' || 'z' < ch) {
 			set_notification("This is not a slot");
@@ -320,117 +327,211 @@ unsigned Console::get_inventory_slot(const Game & game, const Monster & monster)
 	return slot;
 }
 
+unsigned Console::name_id(const std::string & name)
+{
+	if(name.empty()) {
+		return NO_NAME;
+	}
+	std::map<std::string, unsigned>::const_iterator id = name_ids.find(name);
+	if(id != name_ids.end()) {
+		return id->second;
+	}
+	names.push_back(name);
+	return name_ids[name] = unsigned(names.size() - 1);
+}
+
+void Console::add_message(const MessageRecord & record)
+{
+	messages.push_back(record);
+	if(log_messages) {
+		log("Message: " + message_text(unsigned(messages.size() - 1)));
+	}
+	// Record is kept before compacting, so its name and text are kept too.
+	if(messages.size() >= MESSAGE_HISTORY) {
+		compact_messages();
+	}
+}
+
+// Drops oldest seen messages and renumbers names and texts left,
+// so they do not outlive their records. Names keep their strings.
+void Console::compact_messages()
+{
+	unsigned count = unsigned(messages.size());
+	unsigned dropped = (count > MESSAGE_HISTORY / 2) ? std::min(messages_seen, count - MESSAGE_HISTORY / 2) : 0;
+	if(dropped == 0) {
+		return;
+	}
+	std::vector<MessageRecord> kept(messages.begin() + dropped, messages.end());
+	std::vector<std::string> old_names, old_texts;
+	old_names.swap(names);
+	old_texts.swap(texts);
+	name_ids.clear();
+	names.push_back(std::string());
+	std::vector<unsigned> new_ids(old_names.size(), unsigned(NO_NAME));
+	foreach(MessageRecord & record, kept) {
+		if(record.type == MessageRecord::TEXT) {
+			texts.push_back(std::string());
+			texts.back().swap(old_texts[record.actor]);
+			record.actor = record.target = record.help = unsigned(texts.size() - 1);
+			continue;
+		}
+		unsigned * ids[] = { &record.actor, &record.target, &record.help };
+		for(unsigned i = 0; i < 3; ++i) {
+			unsigned * id = ids[i];
+			if(*id != NO_NAME && new_ids[*id] == NO_NAME) {
+				new_ids[*id] = unsigned(names.size());
+				name_ids[old_names[*id]] = new_ids[*id];
+				names.push_back(std::string());
+				names.back().swap(old_names[*id]);
+			}
+			*id = new_ids[*id];
+		}
+	}
+	messages.swap(kept);
+	messages_seen -= dropped;
+}
+
+std::string Console::message_text(unsigned index) const
+{
+	std::string text = render(messages[index]);
+	if(!text.empty()) {
+		text[0] = (char)toupper(text[0]);
+	}
+	return text;
+}
+
 void Console::message(const std::string & text)
 {
 	if(text.empty()) {
 		return;
 	}
-	std::string titled_text = text;
-	titled_text[0] = (char)toupper(titled_text[0]);
-	messages.push_back(titled_text);
-	if(log_messages) {
-		log("Message: " + titled_text);
-	}
+	MessageRecord record;
+	record.type = MessageRecord::TEXT;
+	texts.push_back(text);
+	record.actor = record.target = record.help = unsigned(texts.size() - 1);
+	record.amount = 0;
+	add_message(record);
 }
 
 void Console::message(const GameEvent & e)
 {
+	if(e.type == GameEvent::UNKNOWN || e.type >= GameEvent::COUNT) {
+		log("Unknown event type #{0} with actor <{1}> and target <{2}>", e.type, e.actor.id, e.target.id);
+		return;
+	}
+	MessageRecord record;
+	record.type = e.type;
+	record.actor = name_id(e.actor.name);
+	record.target = name_id(e.target.name);
+	record.help = name_id(e.help.name);
+	record.amount = e.amount;
+	add_message(record);
+}
+
+std::string Console::render(const MessageRecord & e) const
+{
+	if(e.type == MessageRecord::TEXT) {
+		return texts[e.actor];
+	}
+	const std::string & actor = names[e.actor];
+	const std::string & target = names[e.target];
+	const std::string & help = names[e.help];
 	switch(e.type) {
-		case GameEvent::CURES_POISONING: message("{0} cures {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::HEALS: message("{0} heals {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::HURTS: message("{0} hurts {1}!", e.actor.name, e.target.name); break;
-		case GameEvent::IS_HURT_BY_POISONING: message("Poisoning hurts {0}!", e.actor.name); break;
-		case GameEvent::LOSES_HEALTH: message("{0} loses {1} hp.", e.actor.name, e.amount); break;
-		case GameEvent::DIED: message("{0} died.", e.actor.name); break;
-		case GameEvent::HITS: message("{0} hits {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::HITS_FOR_HEALTH: message("{0} hits {1} for {2} hp.", e.actor.name, e.target.name, e.amount); break;
-		case GameEvent::BUMPS_INTO: message("{0} bumps into {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::POISONS: message("{0} poisons {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::SWINGS_AT_NOTHING: message("{0} swing at nothing.", e.actor.name); break;
-		case GameEvent::OPENS: message("{0} opens {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::CLOSES: message("{0} closes {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::DRINKS: message("{0} drinks from {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::GOES_DOWN: message("{0} goes down.", e.actor.name); break;
-		case GameEvent::GOES_UP: message("{0} goes up.", e.actor.name); break;
-		case GameEvent::UNLOCKS: message("{0} unloks {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::TRAP_IS_OUT_OF_ITEMS: message("{0} is out of bolts.", e.actor.name); break;
-		case GameEvent::TRIGGERS: message("{0} triggers {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::EATS: message("{0} eats {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::EMPTIES: message("{0} is emptied.", e.target.name); break;
-		case GameEvent::REFILLS: message("{0} is refilled.", e.target.name); break;
-		case GameEvent::TAKES_OFF: message("{0} takes off {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::THROWS: message("{0} throws {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::UNWIELDS: message("{0} unwields {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::WEARS: message("{0} wears {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::WIELDS: message("{0} wields {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::DROPS_AT: message("{0} drops {1} at {2}.", e.actor.name, e.target.name, e.help.name); break;
-		case GameEvent::FALLS_INTO: message("{0} falls into {1}.", e.actor.name, e.target.name); break;
-		case GameEvent::PICKS_UP_FROM: message("{0} picks up {1} from {2}.", e.actor.name, e.target.name, e.help.name); break;
-		case GameEvent::TAKES_FROM: message("{0} takes {1} from {2}.", e.actor.name, e.target.name, e.help.name); break;
-		case GameEvent::PICKED_UP_A_QUEST_ITEM: message("Now get this {0} to the Temple Gate!", e.target.name); break;
-		case GameEvent::SHOULD_GET_QUEST_ITEM: message("{0} should find explosives first!", e.actor.name); break;
-		case GameEvent::WINS_GAME_WITH: message("{0} successfully brought {1} to the Temple Gate!", e.actor.name, e.target.name); break;
-
-		case GameEvent::ALREADY_CLOSED: message(format("{0} is already closed.", e.actor.name)); break;
-		case GameEvent::ALREADY_FULL: message(format("{0} is already full.", e.actor.name)); break;
-		case GameEvent::ALREADY_OPENED: message(format("{0} is already opened.", e.actor.name)); break;
-		case GameEvent::CANNOT_DRINK: message(format("{0} cannot drink {1}", e.actor.name, e.target.name)); break;
-		case GameEvent::CANNOT_EAT: message(format("{0} is not edible.", e.target.name)); break;
-		case GameEvent::CANNOT_GO_DOWN: message(format("{0} cannot go down there.", e.actor.name)); break;
-		case GameEvent::CANNOT_GO_UP: message(format("{0} cannot go up there.", e.actor.name)); break;
-		case GameEvent::CANNOT_WEAR: message(format("{0} cannot wear {1}.", e.actor.name, e.target.name)); break;
-		case GameEvent::LOCKED: message(format("{0} is locked.", e.actor.name)); break;
-		case GameEvent::NOTHING_TO_CLOSE: message("There is nothing to close there."); break;
-		case GameEvent::NOTHING_TO_DRINK: message("There is nothing to drink there."); break;
-		case GameEvent::NOTHING_TO_DROP: message(format("{0} has nothing to drop.", e.actor.name)); break;
-		case GameEvent::NOTHING_TO_EAT: message(format("{0} has nothing to eat.", e.actor.name)); break;
-		case GameEvent::NOTHING_TO_GRAB: message("There is nothing to grab there."); break;
-		case GameEvent::NOTHING_TO_OPEN: message("There is nothing to open there."); break;
-		case GameEvent::NOTHING_TO_TAKE_OFF: message(format("{0} have nothing to take off.", e.actor.name)); break;
-		case GameEvent::NOTHING_TO_UNWIELD: message(format("{0} have nothing to unwield.", e.actor.name)); break;
-		case GameEvent::NOTHING_TO_WEAR: message(format("{0} has nothing to drop.", e.actor.name)); break;
-		case GameEvent::NOTHING_TO_WIELD: message(format("{0} has nothing to drop.", e.actor.name)); break;
-		case GameEvent::NOTHING_TO_PUT: message(format("{0} have nothing to put down.", e.actor.name)); break;
-		case GameEvent::NOTHING_TO_THROW: message(format("{0} have nothing to throw.", e.actor.name)); break;
-		case GameEvent::NO_SPACE_LEFT: message(format("{0} carries too much items.", e.actor.name)); break;
-		case GameEvent::NO_SUCH_ITEM: message("No such item."); break;
-		case GameEvent::HAS_NO_ITEMS: message(format("{0} is totally empty.", e.actor.name)); break;
+		case GameEvent::CURES_POISONING: return format("{0} cures {1}.", actor, target);
+		case GameEvent::HEALS: return format("{0} heals {1}.", actor, target);
+		case GameEvent::HURTS: return format("{0} hurts {1}!", actor, target);
+		case GameEvent::IS_HURT_BY_POISONING: return format("Poisoning hurts {0}!", actor);
+		case GameEvent::LOSES_HEALTH: return format("{0} loses {1} hp.", actor, e.amount);
+		case GameEvent::DIED: return format("{0} died.", actor);
+		case GameEvent::HITS: return format("{0} hits {1}.", actor, target);
+		case GameEvent::HITS_FOR_HEALTH: return format("{0} hits {1} for {2} hp.", actor, target, e.amount);
+		case GameEvent::BUMPS_INTO: return format("{0} bumps into {1}.", actor, target);
+		case GameEvent::POISONS: return format("{0} poisons {1}.", actor, target);
+		case GameEvent::SWINGS_AT_NOTHING: return format("{0} swing at nothing.", actor);
+		case GameEvent::OPENS: return format("{0} opens {1}.", actor, target);
+		case GameEvent::CLOSES: return format("{0} closes {1}.", actor, target);
+		case GameEvent::DRINKS: return format("{0} drinks from {1}.", actor, target);
+		case GameEvent::GOES_DOWN: return format("{0} goes down.", actor);
+		case GameEvent::GOES_UP: return format("{0} goes up.", actor);
+		case GameEvent::UNLOCKS: return format("{0} unloks {1}.", actor, target);
+		case GameEvent::TRAP_IS_OUT_OF_ITEMS: return format("{0} is out of bolts.", actor);
+		case GameEvent::TRIGGERS: return format("{0} triggers {1}.", actor, target);
+		case GameEvent::EATS: return format("{0} eats {1}.", actor, target);
+		case GameEvent::EMPTIES: return format("{0} is emptied.", target);
+		case GameEvent::REFILLS: return format("{0} is refilled.", target);
+		case GameEvent::TAKES_OFF: return format("{0} takes off {1}.", actor, target);
+		case GameEvent::THROWS: return format("{0} throws {1}.", actor, target);
+		case GameEvent::UNWIELDS: return format("{0} unwields {1}.", actor, target);
+		case GameEvent::WEARS: return format("{0} wears {1}.", actor, target);
+		case GameEvent::WIELDS: return format("{0} wields {1}.", actor, target);
+		case GameEvent::DROPS_AT: return format("{0} drops {1} at {2}.", actor, target, help);
+		case GameEvent::FALLS_INTO: return format("{0} falls into {1}.", actor, target);
+		case GameEvent::PICKS_UP_FROM: return format("{0} picks up {1} from {2}.", actor, target, help);
+		case GameEvent::TAKES_FROM: return format("{0} takes {1} from {2}.", actor, target, help);
+		case GameEvent::PICKED_UP_A_QUEST_ITEM: return format("Now get this {0} to the Temple Gate!", target);
+		case GameEvent::SHOULD_GET_QUEST_ITEM: return format("{0} should find explosives first!", actor);
+		case GameEvent::WINS_GAME_WITH: return format("{0} successfully brought {1} to the Temple Gate!", actor, target);
+
+		case GameEvent::ALREADY_CLOSED: return format("{0} is already closed.", actor);
+		case GameEvent::ALREADY_FULL: return format("{0} is already full.", actor);
+		case GameEvent::ALREADY_OPENED: return format("{0} is already opened.", actor);
+		case GameEvent::CANNOT_DRINK: return format("{0} cannot drink {1}", actor, target);
+		case GameEvent::CANNOT_EAT: return format("{0} is not edible.", target);
+		case GameEvent::CANNOT_GO_DOWN: return format("{0} cannot go down there.", actor);
+		case GameEvent::CANNOT_GO_UP: return format("{0} cannot go up there.", actor);
+		case GameEvent::CANNOT_WEAR: return format("{0} cannot wear {1}.", actor, target);
+		case GameEvent::LOCKED: return format("{0} is locked.", actor);
+		case GameEvent::NOTHING_TO_CLOSE: return "There is nothing to close there.";
+		case GameEvent::NOTHING_TO_DRINK: return "There is nothing to drink there.";
+		case GameEvent::NOTHING_TO_DROP: return format("{0} has nothing to drop.", actor);
+		case GameEvent::NOTHING_TO_EAT: return format("{0} has nothing to eat.", actor);
+		case GameEvent::NOTHING_TO_GRAB: return "There is nothing to grab there.";
+		case GameEvent::NOTHING_TO_OPEN: return "There is nothing to open there.";
+		case GameEvent::NOTHING_TO_TAKE_OFF: return format("{0} have nothing to take off.", actor);
+		case GameEvent::NOTHING_TO_UNWIELD: return format("{0} have nothing to unwield.", actor);
+		case GameEvent::NOTHING_TO_WEAR: return format("{0} has nothing to drop.", actor);
+		case GameEvent::NOTHING_TO_WIELD: return format("{0} has nothing to drop.", actor);
+		case GameEvent::NOTHING_TO_PUT: return format("{0} have nothing to put down.", actor);
+		case GameEvent::NOTHING_TO_THROW: return format("{0} have nothing to throw.", actor);
+		case GameEvent::NO_SPACE_LEFT: return format("{0} carries too much items.", actor);
+		case GameEvent::NO_SUCH_ITEM: return "No such item.";
+		case GameEvent::HAS_NO_ITEMS: return format("{0} is totally empty.", actor);
 		case GameEvent::UNKNOWN:
 		case GameEvent::COUNT:
-		default: log("Unknown event type #{0} with actor <{1}> and target <{2}>", e.type, e.actor.id, e.target.id);
+		default: return std::string();
 	}
 }
 
 
-TempleUI::TempleUI()
-	: Console()
+TempleUI::TempleUI(Backend & console_backend)
+	: Console(console_backend)
 {
-	sprites[Sprites::EMPTY]         = std::make_pair(' ', COLOR_PAIR(0));
-	sprites[Sprites::FLOOR]         = std::make_pair('.', COLOR_PAIR(COLOR_YELLOW));
-	sprites[Sprites::WALL]          = std::make_pair('#', COLOR_PAIR(COLOR_YELLOW));
-	sprites[Sprites::TORCH]         = std::make_pair('&', COLOR_PAIR(COLOR_RED) | A_BOLD);
-	sprites[Sprites::GOO]           = std::make_pair('~', COLOR_PAIR(COLOR_GREEN) | A_BOLD);
-	sprites[Sprites::EXPLOSIVE]     = std::make_pair('*', COLOR_PAIR(COLOR_WHITE) | A_BOLD);
-	sprites[Sprites::MONEY]         = std::make_pair('$', COLOR_PAIR(COLOR_YELLOW));
-	sprites[Sprites::SCORPION_TAIL] = std::make_pair('!', COLOR_PAIR(COLOR_RED));
-	sprites[Sprites::SPEAR]         = std::make_pair('(', COLOR_PAIR(COLOR_BLUE) | A_BOLD);
-	sprites[Sprites::JACKET]        = std::make_pair('[', COLOR_PAIR(COLOR_BLUE) | A_BOLD);
-	sprites[Sprites::ANTIDOTE]      = std::make_pair('%', COLOR_PAIR(COLOR_MAGENTA));
-	sprites[Sprites::APPLE]         = std::make_pair('%', COLOR_PAIR(COLOR_GREEN));
-	sprites[Sprites::PLAYER]        = std::make_pair('@', COLOR_PAIR(COLOR_WHITE) | A_BOLD);
-	sprites[Sprites::ANT]           = std::make_pair('A', COLOR_PAIR(COLOR_YELLOW) | A_BOLD);
-	sprites[Sprites::SCORPION]      = std::make_pair('S', COLOR_PAIR(COLOR_RED) | A_BOLD);
-	sprites[Sprites::DOOR_OPENED]   = std::make_pair('-', COLOR_PAIR(COLOR_WHITE) | A_BOLD);
-	sprites[Sprites::DOOR_CLOSED]   = std::make_pair('+', COLOR_PAIR(COLOR_WHITE) | A_BOLD);
-	sprites[Sprites::POT]           = std::make_pair('V', COLOR_PAIR(COLOR_YELLOW));
-	sprites[Sprites::WELL]          = std::make_pair('{', COLOR_PAIR(COLOR_YELLOW) | A_BOLD);
-	sprites[Sprites::GATE]          = std::make_pair('<', COLOR_PAIR(COLOR_WHITE) | A_BOLD);
-	sprites[Sprites::STAIRS_UP]     = std::make_pair('<', COLOR_PAIR(COLOR_WHITE) | A_BOLD);
-	sprites[Sprites::STAIRS_DOWN]   = std::make_pair('>', COLOR_PAIR(COLOR_WHITE) | A_BOLD);
-	sprites[Sprites::TRAP]          = std::make_pair('^', COLOR_PAIR(COLOR_YELLOW));
-	sprites[Sprites::SHARPENED_POLE] = std::make_pair('(', COLOR_PAIR(COLOR_YELLOW) | A_BOLD);
-	sprites[Sprites::KEY]           = std::make_pair('*', COLOR_PAIR(COLOR_WHITE));
-	sprites[Sprites::FLASK]         = std::make_pair('}', COLOR_PAIR(COLOR_WHITE));
+	sprites[Sprites::EMPTY]         = Glyph(' ', Color::BLACK);
+	sprites[Sprites::FLOOR]         = Glyph('.', Color::YELLOW);
+	sprites[Sprites::WALL]          = Glyph('#', Color::YELLOW);
+	sprites[Sprites::TORCH]         = Glyph('&', Color::RED | Glyph::BOLD);
+	sprites[Sprites::GOO]           = Glyph('~', Color::GREEN | Glyph::BOLD);
+	sprites[Sprites::EXPLOSIVE]     = Glyph('*', Color::WHITE | Glyph::BOLD);
+	sprites[Sprites::MONEY]         = Glyph('$', Color::YELLOW);
+	sprites[Sprites::SCORPION_TAIL] = Glyph('!', Color::RED);
+	sprites[Sprites::SPEAR]         = Glyph('(', Color::BLUE | Glyph::BOLD);
+	sprites[Sprites::JACKET]        = Glyph('[', Color::BLUE | Glyph::BOLD);
+	sprites[Sprites::ANTIDOTE]      = Glyph('%', Color::MAGENTA);
+	sprites[Sprites::APPLE]         = Glyph('%', Color::GREEN);
+	sprites[Sprites::PLAYER]        = Glyph('@', Color::WHITE | Glyph::BOLD);
+	sprites[Sprites::ANT]           = Glyph('A', Color::YELLOW | Glyph::BOLD);
+	sprites[Sprites::SCORPION]      = Glyph('S', Color::RED | Glyph::BOLD);
+	sprites[Sprites::DOOR_OPENED]   = Glyph('-', Color::WHITE | Glyph::BOLD);
+	sprites[Sprites::DOOR_CLOSED]   = Glyph('+', Color::WHITE | Glyph::BOLD);
+	sprites[Sprites::POT]           = Glyph('V', Color::YELLOW);
+	sprites[Sprites::WELL]          = Glyph('{', Color::YELLOW | Glyph::BOLD);
+	sprites[Sprites::GATE]          = Glyph('<', Color::WHITE | Glyph::BOLD);
+	sprites[Sprites::STAIRS_UP]     = Glyph('<', Color::WHITE | Glyph::BOLD);
+	sprites[Sprites::STAIRS_DOWN]   = Glyph('>', Color::WHITE | Glyph::BOLD);
+	sprites[Sprites::TRAP]          = Glyph('^', Color::YELLOW);
+	sprites[Sprites::SHARPENED_POLE] = Glyph('(', Color::YELLOW | Glyph::BOLD);
+	sprites[Sprites::KEY]           = Glyph('*', Color::WHITE);
+	sprites[Sprites::FLASK]         = Glyph('}', Color::WHITE);
 }
 
 TempleUI::~TempleUI()
@@ -1,4 +1,6 @@
 #pragma once
+#include "eventloop.h"
+#include "backend.h"
 #include <chthon/format.h>
 #include <string>
 #include <vector>
@@ -10,6 +12,17 @@ namespace Chthon {
 	class Level;
 	class GameEvent;
 }
+class ItemStacks;
+
+// Message as a fixed-size record; names are interned and the text is
+// rendered only when the message is shown or logged.
+// Free text messages keep their own text (actor is its index in texts).
+struct MessageRecord {
+	enum { TEXT = -1 };
+	int type;
+	unsigned actor, target, help;
+	int amount;
+};
 
 struct Console {
 	struct Window {
@@ -19,31 +32,49 @@ struct Console {
 			: x(window_x), y(window_y), width(window_width), height(window_height) {}
 	};
 
-	static std::map<int, Chthon::Point> directions;
+	std::map<int, Chthon::Point> directions;
 
 	unsigned messages_seen;
 	bool log_messages;
 	std::string notification;
-	std::vector<std::string> messages;
-	std::map<int, std::pair<unsigned char, unsigned> > sprites;
+	// At most MESSAGE_HISTORY messages are kept once they are seen: when
+	// there are that many, older half of seen ones is dropped, along with
+	// names and texts no longer used by kept records.
+	// Names are interned once, when their first record is built;
+	// empty name (no target or help) is always names[NO_NAME].
+	enum { MESSAGE_HISTORY = 256, NO_NAME = 0 };
+	std::vector<MessageRecord> messages;
+	std::vector<std::string> names;
+	std::map<std::string, unsigned> name_ids;
+	std::vector<std::string> texts;
+	std::map<int, Glyph> sprites;
+	// Top left map cell shown in map window; maps may be larger than it.
+	int view_x, view_y;
+	// Inventory shows stacks as one line with a count, when set.
+	const ItemStacks * stacks;
+	Backend & backend;
+	EventLoop event_loop;
 
 	void init_sprites();
 
-	Console();
+	Console(Backend & console_backend);
 	~Console();
 
 	void draw_game(const Chthon::Game & game);
+	void draw_game(const Chthon::Game & game, const Chthon::Point & focus);
 	int draw_and_get_control(Chthon::Game & game);
 	Chthon::Point draw_and_get_direction(Chthon::Game & game);
 	int draw_target_mode(Chthon::Game & game, const Chthon::Point & target);
 	Chthon::Point target_mode(Chthon::Game & game, const Chthon::Point & start);
 	int see_messages(Chthon::Game & game);
 	void draw_inventory(const Chthon::Game & game, const Chthon::Monster & monster);
+	void draw_text(const std::vector<std::string> & lines);
 	unsigned get_inventory_slot(const Chthon::Game & game, const Chthon::Monster & monster);
 	void set_notification(const std::string & text);
 
 	void print_messages(const Window & window);
 	void print_map(const Window & window, const Chthon::Level & level);
+	void update_view(const Window & window, const Chthon::Level & level, const Chthon::Point & focus);
 	void print_notification();
 	void print_tile(int x, int y, int sprite, bool with_color);
 	void print_text(int x, int y, const std::string & text);
@@ -53,19 +84,15 @@ struct Console {
 
 	void message(const Chthon::GameEvent & event);
 	void message(const std::string & text);
-	template<class T>
-		void message(const std::string & text, const T & t)
-		{ message(Chthon::format(text, t)); }
-	template<class T1, class T2>
-		void message(const std::string & text, const T1 & t1, const T2 & t2)
-		{ message(Chthon::format(text, t1, t2)); }
-	template<class T1, class T2, class T3>
-		void message(const std::string & text, const T1 & t1, const T2 & t2, const T3 & t3)
-		{ message(Chthon::format(text, t1, t2, t3)); }
+	std::string message_text(unsigned index) const;
+	std::string render(const MessageRecord & record) const;
+	unsigned name_id(const std::string & name);
+	void add_message(const MessageRecord & record);
+	void compact_messages();
 };
 
 class TempleUI : public Console {
 public:
-	TempleUI();
+	TempleUI(Backend & console_backend);
 	~TempleUI();
 };
@@ -0,0 +1,59 @@
+#include "eventloop.h"
+#include "backend.h"
+
+EventLoop::EventLoop(Backend & loop_backend)
+	: backend(loop_backend), next_task(0)
+{
+}
+
+void EventLoop::add_idle_task(const Task & task)
+{
+	tasks.push_back(IdleTask(task));
+}
+
+bool EventLoop::run_idle_task()
+{
+	for(unsigned i = 0; i < tasks.size(); ++i) {
+		IdleTask & idle = tasks[(next_task + i) % tasks.size()];
+		if(idle.armed) {
+			idle.armed = idle.task();
+			next_task = (next_task + i + 1) % unsigned(tasks.size());
+			return true;
+		}
+	}
+	return false;
+}
+
+int EventLoop::read_key()
+{
+	while(true) {
+		int ch = backend.get_key(0);
+		if(ch != Backend::NO_KEY) {
+			return ch;
+		}
+		if(!run_idle_task()) {
+			return backend.get_key();
+		}
+	}
+}
+
+int EventLoop::get_key()
+{
+	while(true) {
+		int ch = read_key();
+		if(ch == Backend::NO_KEY) {
+			continue;
+		}
+		// Escape followed by another key (e.g. Alt+key) yields that key.
+		if(ch == Backend::KEY_ESCAPE) {
+			int next = backend.get_key(ESCAPE_DELAY);
+			if(next != Backend::NO_KEY) {
+				ch = next;
+			}
+		}
+		for(unsigned i = 0; i < tasks.size(); ++i) {
+			tasks[i].armed = true;
+		}
+		return ch;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <functional>
+#include <vector>
+class Backend;
+
+// Waits for keypresses and spends the time in between on idle tasks.
+// A task returns true while it has more work to do; all tasks are
+// rearmed after every keypress, as each key may change the game.
+class EventLoop {
+public:
+	typedef std::function<bool()> Task;
+	enum { ESCAPE_DELAY = 25 };
+
+	EventLoop(Backend & loop_backend);
+	void add_idle_task(const Task & task);
+	int get_key();
+private:
+	struct IdleTask {
+		Task task;
+		bool armed;
+		IdleTask(const Task & idle_task) : task(idle_task), armed(true) {}
+	};
+	Backend & backend;
+	std::vector<IdleTask> tasks;
+	unsigned next_task;
+	bool run_idle_task();
+	int read_key();
+};
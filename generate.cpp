@@ -1,22 +1,30 @@
 #include "generate.h"
+#include "ai.h"
 #include "sprites.h"
 #include <chthon/log.h>
-#include <cstdlib>
+#include <algorithm>
 using namespace Chthon;
 
 namespace AI {
 	enum { DUMMY, PLAYER, ANGRY_AND_WANDER, ANGRY_AND_STILL, CALM_AND_STILL };
 }
 
+enum { LEVEL_STREAM = 1, AI_STREAM };
+// One extra corridor per this many rooms.
+enum { LOOP_RATIO = 6 };
+
 LinearDungeon::LinearDungeon(Controller * player_controller)
-	: Game()
+	: Game(), seed(0), ai_random(Rng::stream(0, AI_STREAM))
 {
+	// Player actions, random steps and waits come from per-thread pools (pool.h).
+	// Allocations left on monster turns are those of calm monsters: BasicAI
+	// belongs to Chthon and creates its actions with plain new.
 	controller_factory.add_controller(AI::PLAYER, player_controller);
 	controller_factory.add_controller(AI::ANGRY_AND_WANDER,
-			(new BasicAI())->add(BasicAI::MOVE_TO_HIT_PLAYER_IF_SEES)->add(BasicAI::HIT_PLAYER_IF_NEAR)->add(BasicAI::MOVE_RANDOM)
+			(new TempleAI(ai_random))->add(TempleAI::MOVE_TO_HIT_PLAYER_IF_SEES)->add(TempleAI::HIT_PLAYER_IF_NEAR)->add(TempleAI::MOVE_RANDOM)
 			);
 	controller_factory.add_controller(AI::ANGRY_AND_STILL,
-			(new BasicAI())->add(BasicAI::MOVE_TO_HIT_PLAYER_IF_SEES)->add(BasicAI::HIT_PLAYER_IF_NEAR)
+			(new TempleAI(ai_random))->add(TempleAI::MOVE_TO_HIT_PLAYER_IF_SEES)->add(TempleAI::HIT_PLAYER_IF_NEAR)->add(TempleAI::WAIT)
 			);
 	controller_factory.add_controller(AI::CALM_AND_STILL,
 			(new BasicAI())->add(BasicAI::HIT_PLAYER_IF_NEAR)->add(BasicAI::WAIT)
@@ -55,56 +63,321 @@ LinearDungeon::LinearDungeon(Controller * player_controller)
 	item_types.insert("key").sprite(Sprites::KEY).name("key");
 	item_types.insert("empty_flask").sprite(Sprites::FLASK).name("empty flask");
 	item_types.insert("full_flask").sprite(Sprites::FLASK).name("water flask").edible().healing(5);
+
+	const char * stackable[] = { "money", "scorpion_tail", "antidote", "apple", "empty_flask", "full_flask" };
+	stacks.stackable_types.insert(stackable, stackable + sizeof(stackable) / sizeof(stackable[0]));
+}
+
+void LinearDungeon::set_seed(unsigned game_seed)
+{
+	seed = game_seed;
+	ai_random = Rng::stream(seed, AI_STREAM);
+	forget_baselines();
 }
 
 void LinearDungeon::generate(Level & level, int level_index)
 {
+	if(pager.page_in(*this, level, level_index)) {
+		travel_planner.prepare(level, level_index);
+		return;
+	}
 	log("Generating level {0}...", level_index);
+	build_level(level, level_index);
+	travel_planner.prepare(level, level_index);
+	log("Done.");
+}
 
-	level = Level(60, 23);
-	log("Level cleared.");
+const LevelBaseline * LinearDungeon::baseline(int level_index) const
+{
+	std::map<int, LevelBaseline>::const_iterator baseline = baselines.find(level_index);
+	return (baseline == baselines.end()) ? nullptr : &baseline->second;
+}
 
-	level.map.fill(Cell(cell_types.get("wall")));
-	log("Map filled.");
+const LevelBaseline & LinearDungeon::regenerate_baseline(int level_index)
+{
+	if(baselines.count(level_index) == 0) {
+		Level scratch;
+		build_level(scratch, level_index);
+	}
+	return baselines[level_index];
+}
 
-	std::vector<std::pair<Point, Point> > rooms;
-	for(int y = 0; y < 3; ++y) {
-		for(int x = 0; x < 3; ++x) {
-			unsigned cell_width = level.map.width / 3;
-			unsigned cell_height = level.map.height / 3;
+void LinearDungeon::forget_baselines()
+{
+	baselines.clear();
+}
+
+// FNV-1a over map size and cell type ids.
+static unsigned hash_bytes(unsigned hash, const void * data, size_t size)
+{
+	const unsigned char * bytes = static_cast<const unsigned char *>(data);
+	for(size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+void LinearDungeon::remember_baseline(const Level & level, int level_index)
+{
+	LevelBaseline baseline;
+	baseline.width = level.map.width;
+	baseline.height = level.map.height;
+	baseline.cells.reserve(level.map.cells.size());
+	baseline.hash = hash_bytes(2166136261u, &baseline.width, sizeof(baseline.width));
+	baseline.hash = hash_bytes(baseline.hash, &baseline.height, sizeof(baseline.height));
+	std::map<std::string, unsigned char> palette;
+	foreach(const Cell & cell, level.map.cells) {
+		const std::string & id = cell.type->id;
+		std::map<std::string, unsigned char>::const_iterator index = palette.find(id);
+		if(index == palette.end()) {
+			if(baseline.cell_ids.size() > 255) {
+				log("Too many cell types for level baseline, level {0} will be stored in full.", level_index);
+				baselines.erase(level_index);
+				return;
+			}
+			index = palette.insert(std::make_pair(id, (unsigned char)baseline.cell_ids.size())).first;
+			baseline.cell_ids.push_back(id);
+		}
+		baseline.cells.push_back(index->second);
+		baseline.hash = hash_bytes(baseline.hash, id.c_str(), id.size() + 1);
+	}
+	baselines[level_index] = baseline;
+}
+
+typedef std::pair<Point, Point> Room;
+
+// Level building draws only from the level's own Rng, never from global
+// rand(), so a level is the same on any thread and in any order.
+// Rooms exclude their bottom right corner.
+static void fill_room(Map<Cell> & map, const Room & room, const CellType * type)
+{
+	for(int y = room.first.y; y < room.second.y; ++y) {
+		for(int x = room.first.x; x < room.second.x; ++x) {
+			map.cell(x, y) = Cell(type);
+		}
+	}
+}
+
+// Distinct random cells of the room, no more than it has.
+static std::vector<Point> random_positions(Rng & random, const Room & room, unsigned count)
+{
+	std::vector<Point> positions;
+	for(int y = room.first.y; y < room.second.y; ++y) {
+		for(int x = room.first.x; x < room.second.x; ++x) {
+			positions.push_back(Point(x, y));
+		}
+	}
+	count = std::min(count, unsigned(positions.size()));
+	for(unsigned i = 0; i < count; ++i) {
+		std::swap(positions[i], positions[i + random.range(unsigned(positions.size()) - i)]);
+	}
+	positions.resize(count);
+	return positions;
+}
+
+// Digs a straight corridor between two rooms which lie side by side,
+// at a random row (or column) they share. Returns door cells in the walls
+// of the first and the second room, or null points if rooms do not face.
+static std::pair<Point, Point> connect_rooms(Rng & random, Level & level, const Room & a, const Room & b, const CellType * floor)
+{
+	bool is_horizontal = a.second.x <= b.first.x || b.second.x <= a.first.x;
+	const Room & first = (is_horizontal ? a.first.x < b.first.x : a.first.y < b.first.y) ? a : b;
+	const Room & second = (&first == &a) ? b : a;
+	int from = is_horizontal ? std::max(first.first.y, second.first.y) : std::max(first.first.x, second.first.x);
+	int to = is_horizontal ? std::min(first.second.y, second.second.y) : std::min(first.second.x, second.second.x);
+	if(from >= to) {
+		return std::make_pair(Point(), Point());
+	}
+	int across = random.range(from, to - 1);
+	Point start = is_horizontal ? Point(first.second.x, across) : Point(across, first.second.y);
+	Point end = is_horizontal ? Point(second.first.x - 1, across) : Point(across, second.first.y - 1);
+	Point step = is_horizontal ? Point(1, 0) : Point(0, 1);
+	for(Point pos = start; !(pos == end + step); pos = pos + step) {
+		level.map.cell(pos) = Cell(floor);
+	}
+	return (&first == &a) ? std::make_pair(start, end) : std::make_pair(end, start);
+}
+
+static unsigned room_capacity(const std::pair<Point, Point> & room)
+{
+	return unsigned(room.second.x - room.first.x) * unsigned(room.second.y - room.first.y);
+}
+
+static void append_content(std::string & content, const std::string & more, unsigned capacity)
+{
+	if(content.size() < capacity) {
+		content += more.substr(0, capacity - content.size());
+	}
+}
+
+enum { MAX_TEMPLATE_REPEATS = 2 };
+
+static std::string without_monsters(const std::string & content)
+{
+	std::string result;
+	foreach(char cell, content) {
+		if(cell != 'a' && cell != 'A' && cell != 'S') {
+			result += cell;
+		}
+	}
+	return result;
+}
+
+// First template goes to the first room and the last one to the last room.
+// Middle templates are repeated over extra rooms or merged when rooms are few.
+// Monsters come with the first MAX_TEMPLATE_REPEATS repeats only, so large
+// grids get more rooms to explore rather than more monsters than designed.
+static std::vector<std::string> spread_content(const std::vector<std::string> & templates, unsigned room_count, unsigned capacity)
+{
+	std::vector<std::string> content(room_count);
+	content.front() = templates.front();
+	content.back() = templates.back();
+	unsigned middle_templates = unsigned(templates.size()) - 2;
+	unsigned middle_rooms = room_count - 2;
+	if(middle_rooms == 0) {
+		for(unsigned i = 0; i < middle_templates; ++i) {
+			append_content(content.front(), templates[1 + i], capacity);
+		}
+	} else if(middle_rooms >= middle_templates) {
+		for(unsigned i = 0; i < middle_rooms; ++i) {
+			content[1 + i] = templates[1 + i % middle_templates];
+			if(i / middle_templates >= MAX_TEMPLATE_REPEATS) {
+				content[1 + i] = without_monsters(content[1 + i]);
+			}
+		}
+	} else {
+		for(unsigned i = 0; i < middle_templates; ++i) {
+			append_content(content[1 + i % middle_rooms], templates[1 + i], capacity);
+		}
+	}
+	return content;
+}
+
+// Picks rooms with a randomized depth-first walk over grid cells.
+// Every room is connected to its parent, which is always a grid neighbour,
+// and the last room in walk order is a leaf, so it is reachable only
+// through its own door.
+// A few extra corridors (loops) join other neighbouring rooms, so the
+// level is not a pure tree; the last room never gets one.
+void LinearDungeon::arrange_rooms(Rng & random, unsigned width, unsigned height,
+		std::vector<std::pair<Point, Point> > & rooms, std::vector<int> & parents,
+		std::vector<std::pair<unsigned, unsigned> > & loops) const
+{
+	unsigned cell_width = width / grid.columns;
+	unsigned cell_height = height / grid.rows;
+	unsigned room_count = grid.room_count();
+	std::vector<int> room_of_cell(grid.columns * grid.rows, -1);
+	std::vector<unsigned> stack;
+
+	unsigned cell = random.range(grid.columns * grid.rows);
+	while(true) {
+		if(room_of_cell[cell] < 0) {
+			int x = int(cell % grid.columns), y = int(cell / grid.columns);
 			Point topleft = Point(x * int(cell_width) + 2, y * int(cell_height) + 2);
 			Point bottomright = Point(x * int(cell_width) + int(cell_width) - 2, y * int(cell_height) + int(cell_height) - 2);
+			parents.push_back(stack.empty() ? -1 : room_of_cell[stack.back()]);
+			room_of_cell[cell] = int(rooms.size());
 			rooms.push_back(std::make_pair(topleft, bottomright));
+			stack.push_back(cell);
+		}
+		if(rooms.size() >= room_count || stack.empty()) {
+			break;
+		}
+		unsigned current = stack.back();
+		unsigned x = current % grid.columns, y = current / grid.columns;
+		unsigned neighbours[4];
+		unsigned neighbour_count = 0;
+		if(x > 0 && room_of_cell[current - 1] < 0) {
+			neighbours[neighbour_count++] = current - 1;
+		}
+		if(x + 1 < grid.columns && room_of_cell[current + 1] < 0) {
+			neighbours[neighbour_count++] = current + 1;
+		}
+		if(y > 0 && room_of_cell[current - grid.columns] < 0) {
+			neighbours[neighbour_count++] = current - grid.columns;
 		}
+		if(y + 1 < grid.rows && room_of_cell[current + grid.columns] < 0) {
+			neighbours[neighbour_count++] = current + grid.columns;
+		}
+		if(neighbour_count == 0) {
+			stack.pop_back();
+			if(stack.empty()) {
+				break;
+			}
+			cell = stack.back();
+		} else {
+			cell = neighbours[random.range(neighbour_count)];
+		}
+	}
+
+	unsigned last_room = unsigned(rooms.size() - 1);
+	std::vector<std::pair<unsigned, unsigned> > candidates;
+	for(unsigned current = 0; current < room_of_cell.size(); ++current) {
+		unsigned x = current % grid.columns, y = current / grid.columns;
+		unsigned others[2];
+		unsigned other_count = 0;
+		if(x + 1 < grid.columns) {
+			others[other_count++] = current + 1;
+		}
+		if(y + 1 < grid.rows) {
+			others[other_count++] = current + grid.columns;
+		}
+		for(unsigned i = 0; i < other_count; ++i) {
+			int a = room_of_cell[current], b = room_of_cell[others[i]];
+			if(a < 0 || b < 0 || unsigned(a) == last_room || unsigned(b) == last_room) {
+				continue;
+			}
+			if(parents[unsigned(a)] == b || parents[unsigned(b)] == a) {
+				continue;
+			}
+			candidates.push_back(std::make_pair(unsigned(a), unsigned(b)));
+		}
+	}
+	unsigned loop_count = std::min(unsigned(rooms.size()) / LOOP_RATIO, unsigned(candidates.size()));
+	for(unsigned i = 0; i < loop_count; ++i) {
+		std::swap(candidates[i], candidates[i + random.range(unsigned(candidates.size()) - i)]);
+		loops.push_back(candidates[i]);
 	}
-	rooms = DungeonBuilder::shuffle_rooms(rooms);
-	log("Rooms arranged.");
+}
 
-	std::vector<std::string> room_content;
+void LinearDungeon::build_level(Level & level, int level_index)
+{
+	Rng random = Rng::stream(seed, LEVEL_STREAM, unsigned(level_index));
+
+	level = Level(grid.map_width(), grid.map_height());
+
+	level.map.fill(Cell(cell_types.get("wall")));
+
+	std::vector<std::pair<Point, Point> > rooms;
+	std::vector<int> parents;
+	std::vector<std::pair<unsigned, unsigned> > loops;
+	arrange_rooms(random, level.map.width, level.map.height, rooms, parents, loops);
+
+	std::vector<std::string> templates;
 	switch(level_index) {
 		case 1:
-			room_content
+			templates
 				<< "^@}<" << "a" << "%a"
 				<< "####^Aa" << "%Aa" << "&%AAa}"
 				<< "&&(AAA" << "&&&&^%A%A" << "####AAAA>"
 				;
 			break;
 		case 2:
-			room_content
+			templates
 				<< "&@<%}" << "AAAV" << "########^^S%%"
 				<< "(SaAAA" << "V%%%}" << "AAASS"
 				<< "&&&&~~~~~~~~~~~~{%" << "V[SSSAA%" << "####SSSSAAAA>"
 				;
 			break;
 		case 3:
-			room_content
+			templates
 				<< "####&^^@<%%(" << "~~~~~~~~^VSSSS" << "####AAASSS%%"
 				<< "####~~~~SSSAAAAA%%" << "####~~~~VSSSSS%" << "####~~~~VVSSSSSSSAAA%%%"
 				<< "####~~~~VVSSSSSSSSSS" << "####VVV^^^%%%%%%%(" << "SSSSSSSSAAAAAAAA~~~~~~~~~~~~>"
 				;
 			break;
 		default:
-			room_content
+			templates
 				<< "@<" << std::string(32, '~') << std::string(32, '~')
 				<< std::string(32, '~') << std::string(32, '~') << std::string(32, '~')
 				<< std::string(32, '~') << std::string(32, '~') << "*";
@@ -112,16 +385,19 @@ void LinearDungeon::generate(Level & level, int level_index)
 			break;
 	}
 
+	std::vector<std::string> room_content = spread_content(templates, unsigned(rooms.size()), room_capacity(rooms.front()));
+
 	for(unsigned i = 0; i < rooms.size(); ++i) {
 		bool is_last_room = i == rooms.size() - 1;
 		if(is_last_room) {
 			if(!level.monsters.empty()) {
-				unsigned key_holder = (unsigned)rand() % level.monsters.size();
+				unsigned key_holder = random.range(unsigned(level.monsters.size()));
 				level.monsters[key_holder].inventory.insert(Item::Builder(item_types.get("key")).key_type(level_index));
 			}
 		}
-		DungeonBuilder::fill_room(level.map, rooms[i], cell_types.get("floor"));
-		std::vector<Point> positions = DungeonBuilder::random_positions(rooms[i], room_content[i].size());
+		fill_room(level.map, rooms[i], cell_types.get("floor"));
+		std::vector<Point> positions = random_positions(random, rooms[i], unsigned(room_content[i].size()));
+		room_content[i].resize(positions.size());
 		foreach(char cell, room_content[i]) {
 			Point pos = positions.back();
 			positions.pop_back();
@@ -166,7 +442,7 @@ void LinearDungeon::generate(Level & level, int level_index)
 			}
 		}
 		if(i > 0) {
-			std::pair<Point, Point> doors = DungeonBuilder::connect_rooms(level, rooms[i], rooms[i - 1], cell_types.get("floor"));
+			std::pair<Point, Point> doors = connect_rooms(random, level, rooms[i], rooms[unsigned(parents[i])], cell_types.get("floor"));
 			if(!doors.first.null() && !doors.second.null()) {
 				add_object(level, "closed_door", "opened_door").pos(doors.first);
 				if(is_last_room) {
@@ -177,10 +453,14 @@ void LinearDungeon::generate(Level & level, int level_index)
 			}
 		}
 	}
-	log("Rooms filled.");
+	for(unsigned i = 0; i < loops.size(); ++i) {
+		std::pair<Point, Point> doors = connect_rooms(random, level, rooms[loops[i].first], rooms[loops[i].second], cell_types.get("floor"));
+		if(!doors.first.null() && !doors.second.null()) {
+			add_object(level, "closed_door", "opened_door").pos(doors.first);
+			add_object(level, "closed_door", "opened_door").pos(doors.second);
+		}
+	}
 	DungeonBuilder::pop_player_front(level.monsters);
-	log("Player popped.");
-
-	log("Done.");
+	remember_baseline(level, level_index);
 }
 
@@ -1,9 +1,53 @@
 #pragma once
+#include "pager.h"
+#include "pathfinding.h"
+#include "rng.h"
+#include "roomgrid.h"
+#include "stacks.h"
 #include <chthon/game.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Cell types of a level as it was generated, before anything changed it.
+// Savefile and pager store a level as the difference against it, and the
+// hash checks that the level is regenerated identically on load.
+struct LevelBaseline {
+	unsigned width, height;
+	// Indices into cell_ids.
+	std::vector<unsigned char> cells;
+	std::vector<std::string> cell_ids;
+	unsigned hash;
+
+	const std::string & cell_id(unsigned x, unsigned y) const { return cell_ids[cells[x + y * width]]; }
+};
 
 class LinearDungeon : public Chthon::Game {
 public:
+	LevelPager pager;
+	TravelPlanner travel_planner;
+	// Levels are generated from streams derived from the seed,
+	// AI draws from its own stream which is stored in savefile.
+	unsigned seed;
+	Rng ai_random;
+	// Layout of generated levels, stored in savefile along with the seed.
+	RoomGrid grid;
+	ItemStacks stacks;
+
 	LinearDungeon(Chthon::Controller * player_controller);
+	void set_seed(unsigned game_seed);
 	virtual ~LinearDungeon() {}
 	virtual void generate(Chthon::Level & level, int level_index);
+	// Baseline of a level generated (or regenerated) in this game, if any.
+	const LevelBaseline * baseline(int level_index) const;
+	// Same, regenerating the level in a scratch Level when not known yet.
+	const LevelBaseline & regenerate_baseline(int level_index);
+	void forget_baselines();
+private:
+	std::map<int, LevelBaseline> baselines;
+	void build_level(Chthon::Level & level, int level_index);
+	void remember_baseline(const Chthon::Level & level, int level_index);
+	void arrange_rooms(Rng & random, unsigned width, unsigned height,
+			std::vector<std::pair<Chthon::Point, Chthon::Point> > & rooms, std::vector<int> & parents,
+			std::vector<std::pair<unsigned, unsigned> > & loops) const;
 };
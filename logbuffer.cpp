@@ -0,0 +1,100 @@
+#include "logbuffer.h"
+#include <chthon/log.h>
+#include <ostream>
+#include <streambuf>
+#include <mutex>
+#include <string>
+using namespace Chthon;
+
+static thread_local std::streambuf * thread_sink = nullptr;
+
+// Each thread collects its own line and writes it out whole,
+// so lines from different threads never interleave.
+class SynchronizedBuffer : public std::streambuf {
+public:
+	SynchronizedBuffer() : target(nullptr) {}
+	void set_target(std::streambuf * target_buffer)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		target = target_buffer;
+	}
+protected:
+	virtual int overflow(int ch)
+	{
+		if(ch != traits_type::eof()) {
+			line() += char(ch);
+			if(ch == '\n') {
+				write_line();
+			}
+		}
+		return ch;
+	}
+	virtual std::streamsize xsputn(const char * s, std::streamsize n)
+	{
+		line().append(s, size_t(n));
+		if(line().find('\n') != std::string::npos) {
+			write_line();
+		}
+		return n;
+	}
+	virtual int sync()
+	{
+		write_line();
+		std::lock_guard<std::mutex> lock(mutex);
+		std::streambuf * out = current();
+		return out ? out->pubsync() : 0;
+	}
+private:
+	std::streambuf * target;
+	std::mutex mutex;
+	std::streambuf * current() const { return thread_sink ? thread_sink : target; }
+	static std::string & line()
+	{
+		static thread_local std::string buffer;
+		return buffer;
+	}
+	void write_line()
+	{
+		std::string & text = line();
+		if(text.empty()) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		std::streambuf * out = current();
+		if(out) {
+			out->sputn(text.data(), std::streamsize(text.size()));
+		}
+		text.clear();
+	}
+};
+
+static SynchronizedBuffer log_buffer;
+static std::ostream log_stream(&log_buffer);
+
+void direct_synchronized_log(std::ostream & target)
+{
+	log_buffer.set_target(target.rdbuf());
+	direct_log(&log_stream);
+}
+
+LogRedirect::LogRedirect(std::ostream & sink)
+	: previous(thread_sink)
+{
+	thread_sink = sink.rdbuf();
+}
+
+LogRedirect::LogRedirect(std::streambuf * sink)
+	: previous(thread_sink)
+{
+	thread_sink = sink;
+}
+
+std::streambuf * LogRedirect::current_sink()
+{
+	return thread_sink;
+}
+
+LogRedirect::~LogRedirect()
+{
+	thread_sink = previous;
+}
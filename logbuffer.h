@@ -0,0 +1,22 @@
+#pragma once
+#include <iosfwd>
+
+// Chthon log is process-wide. It is pointed once at a stream that
+// serializes writes from all threads and lives until the process exits.
+void direct_synchronized_log(std::ostream & target);
+
+// Diverts log lines of the current thread to its own sink while alive,
+// e.g. to keep each server session in a separate file.
+// Threads started by a session pass on its sink to log into the same place.
+class LogRedirect {
+public:
+	LogRedirect(std::ostream & sink);
+	LogRedirect(std::streambuf * sink);
+	~LogRedirect();
+	// Sink of the current thread; null when it logs to the common target.
+	static std::streambuf * current_sink();
+private:
+	std::streambuf * previous;
+	LogRedirect(const LogRedirect &);
+	LogRedirect & operator=(const LogRedirect &);
+};
@@ -1,73 +1,109 @@
-#include "generate.h"
-#include "player.h"
-#include "console.h"
-#include "savefile.h"
-#include <chthon/game.h>
-#include <chthon/files.h>
+#include "session.h"
+#include "server.h"
+#include "backend.h"
+#include "recording.h"
+#include "stress.h"
+#include "logbuffer.h"
 #include <chthon/log.h>
-#include <chthon/format.h>
 #include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <ctime>
+#include <fstream>
 #include <string>
+#include <memory>
+#include <chrono>
+#include <exception>
+#include <unistd.h>
 using namespace Chthon;
 
 const std::string SAVEFILE = "temple.sav";
 
-static bool load_game(Game & game)
+static bool is_number(int i, int argc, char ** argv)
 {
-	if(!file_exists(SAVEFILE)) {
-		game.create_new_game();
-		return true;
-	}
-	try {
-		std::ifstream in(SAVEFILE.c_str(), std::ios::in);
-		if(!in) {
-			throw Reader::Exception(format("Cannot open file '{0}' for reading!", SAVEFILE));
-		}
-		Reader savefile(in);
-		load(savefile, game);
-		if(remove(SAVEFILE.c_str()) != 0) {
-			throw Reader::Exception("Error: cannot delete savefile!");
-		}
-	} catch(const Reader::Exception & e) {
-		log(e.message);
-		return false;
-	}
-	return true;
+	return i < argc && isdigit(argv[i][0]);
 }
 
-static void save(const Game & game)
+int main(int argc, char ** argv)
 {
-	try {
-		std::ofstream out(SAVEFILE.c_str(), std::ios::out);
-		if(!out) {
-			throw Writer::Exception(format("Cannot open file '{0}' for writing!", SAVEFILE));
-		}
-		Writer savefile(out);
-		save(savefile, game);
-	} catch(const Writer::Exception & e) {
-		log(e.message);
-	}
-}
-
-int main()
-{
-	srand((unsigned)time(nullptr));
+	std::chrono::steady_clock::time_point process_started = std::chrono::steady_clock::now();
+	// Game loader thread logs too.
 	std::ofstream log_file("temple.log", std::ios::app);
-	direct_log(&log_file);
+	direct_synchronized_log(log_file);
 
-	TempleUI console;
-	Chthon::Controller * player = new PlayerControl(console);
-	LinearDungeon game(player);
-	console.log_messages = true;
-	if(!load_game(game)) {
-		return 1;
+	bool use_ansi = false;
+	bool stress_generator = false;
+	unsigned level_count = 1000000, workers = 0, first_seed = 1;
+	std::string playback_name;
+	SessionOptions options(SAVEFILE, unsigned(time(nullptr)));
+	options.log_messages = true;
+	options.started = process_started;
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if(arg == "--server") {
+			int port = (i + 1 < argc) ? atoi(argv[i + 1]) : 0;
+			return run_server(port > 0 ? port : DEFAULT_SERVER_PORT, log_file);
+		} else if(arg == "--stress-generator") {
+			stress_generator = true;
+			if(is_number(i + 1, argc, argv)) {
+				level_count = unsigned(atoi(argv[++i]));
+				if(is_number(i + 1, argc, argv)) {
+					workers = unsigned(atoi(argv[++i]));
+					if(is_number(i + 1, argc, argv)) {
+						first_seed = unsigned(atoi(argv[++i]));
+					}
+				}
+			}
+		} else if(arg == "--grid" && i + 1 < argc) {
+			unsigned columns = 0, rows = 0;
+			if(sscanf(argv[++i], "%ux%u", &columns, &rows) != 2 || !RoomGrid(columns, rows).valid()) {
+				log("Invalid room grid: '{0}', expected COLUMNSxROWS.", argv[i]);
+				return 1;
+			}
+			options.grid.columns = columns;
+			options.grid.rows = rows;
+		} else if(arg == "--rooms" && i + 1 < argc) {
+			options.grid.rooms = unsigned(atoi(argv[++i]));
+		} else if(arg == "--ansi") {
+			use_ansi = true;
+		} else if(arg == "--record" && i + 1 < argc) {
+			options.recording_name = argv[++i];
+		} else if(arg == "--seed" && i + 1 < argc) {
+			options.seed = unsigned(strtoul(argv[++i], nullptr, 10));
+		} else if(arg == "--travel-opens-doors") {
+			options.travel_opens_doors = true;
+		} else if(arg == "--level-memory" && i + 1 < argc) {
+			options.level_memory_budget = size_t(atol(argv[++i])) * 1024;
+		} else if(arg == "--play" && i + 1 < argc) {
+			playback_name = argv[++i];
+		} else {
+			log("Unknown argument: '{0}'", arg);
+			return 1;
+		}
+	}
+	if(stress_generator) {
+		return run_generator_stress(level_count, workers, first_seed, options.grid);
 	}
-	game.run();
-	console.see_messages(game);
-	if(game.state == Game::SUSPENDED) {
-		save(game);
+
+	int result = 0;
+	try {
+		std::unique_ptr<Backend> backend;
+		if(use_ansi) {
+			backend.reset(new AnsiBackend(STDIN_FILENO, STDOUT_FILENO));
+		} else {
+			backend.reset(new NCursesBackend());
+		}
+		if(!playback_name.empty()) {
+			backend->init();
+			result = play_recording(*backend, playback_name);
+		} else {
+			result = play(*backend, options);
+		}
+	} catch(const std::exception & e) {
+		log("Error: {0}", e.what());
+		result = 1;
 	}
 
 	log("Exiting.");
-	return 0;
+	return result;
 }
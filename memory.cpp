@@ -0,0 +1,95 @@
+#include "memory.h"
+#include "pager.h"
+#include "console.h"
+#include <chthon/game.h>
+#include <chthon/level.h>
+#include <chthon/format.h>
+using namespace Chthon;
+
+static void add_items(MemoryUsage & usage, const std::vector<Item> & items)
+{
+	usage.add(unsigned(items.size()), items.capacity() * sizeof(Item));
+}
+
+size_t LevelMemory::total() const
+{
+	return sizeof(Level) + cells.bytes + monsters.bytes + plans.bytes + inventory_items.bytes
+		+ items.bytes + objects.bytes + object_items.bytes;
+}
+
+LevelMemory measure_level(const Level & level)
+{
+	LevelMemory result;
+	unsigned cell_count = level.map.width * level.map.height;
+	result.cells.add(cell_count, cell_count * sizeof(Cell));
+	result.monsters.add(unsigned(level.monsters.size()), level.monsters.capacity() * sizeof(Monster));
+	foreach(const Monster & monster, level.monsters) {
+		add_items(result.inventory_items, monster.inventory.items);
+		result.plans.add(unsigned(monster.plan.size()), monster.plan.size() * sizeof(Action*));
+	}
+	add_items(result.items, level.items);
+	result.objects.add(unsigned(level.objects.size()), level.objects.capacity() * sizeof(Object));
+	foreach(const Object & object, level.objects) {
+		add_items(result.object_items, object.items);
+	}
+	return result;
+}
+
+size_t estimate_level_memory(const Level & level)
+{
+	return measure_level(level).total();
+}
+
+void MemoryReport::add_game(const Game & game, const LevelPager * pager)
+{
+	for(std::map<int, Level>::const_iterator level = game.levels.begin(); level != game.levels.end(); ++level) {
+		levels[level->first] = measure_level(level->second);
+	}
+	if(pager) {
+		foreach(int level_index, pager->paged_levels()) {
+			paged_levels.add(1, pager->paged_size(level_index));
+		}
+	}
+}
+
+void MemoryReport::add_console(const Console & console)
+{
+	size_t bytes = console.messages.capacity() * sizeof(MessageRecord);
+	bytes += console.names.capacity() * sizeof(std::string);
+	foreach(const std::string & name, console.names) {
+		bytes += 2 * name.capacity() + sizeof(std::pair<const std::string, unsigned>);
+	}
+	bytes += console.texts.capacity() * sizeof(std::string);
+	foreach(const std::string & text, console.texts) {
+		bytes += text.capacity();
+	}
+	messages.add(unsigned(console.messages.size()), bytes);
+}
+
+static std::string usage_line(const std::string & name, const MemoryUsage & usage)
+{
+	return format("  {0}: {1} in {2} bytes", name, usage.count, usage.bytes);
+}
+
+std::vector<std::string> MemoryReport::lines() const
+{
+	std::vector<std::string> result;
+	size_t total = messages.bytes + travel.bytes;
+	for(std::map<int, LevelMemory>::const_iterator level = levels.begin(); level != levels.end(); ++level) {
+		const LevelMemory & usage = level->second;
+		result.push_back(format("Level {0}: {1} bytes", level->first, usage.total()));
+		result.push_back(usage_line("cells", usage.cells));
+		result.push_back(usage_line("monsters", usage.monsters));
+		result.push_back(usage_line("planned actions", usage.plans));
+		result.push_back(usage_line("inventory items", usage.inventory_items));
+		result.push_back(usage_line("items", usage.items));
+		result.push_back(usage_line("objects", usage.objects));
+		result.push_back(usage_line("items in objects", usage.object_items));
+		total += usage.total();
+	}
+	result.push_back(format("Paged out levels: {0} in {1} bytes on disk", paged_levels.count, paged_levels.bytes));
+	result.push_back(format("Messages: {0} in {1} bytes", messages.count, messages.bytes));
+	result.push_back(format("Travel path: {0} steps in {1} bytes", travel.count, travel.bytes));
+	result.push_back(format("Total resident: {0} bytes", total));
+	return result;
+}
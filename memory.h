@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+namespace Chthon {
+	class Game;
+	class Level;
+}
+struct Console;
+class LevelPager;
+
+struct MemoryUsage {
+	unsigned count;
+	size_t bytes;
+	MemoryUsage() : count(0), bytes(0) {}
+	void add(unsigned usage_count, size_t usage_bytes) { count += usage_count; bytes += usage_bytes; }
+};
+
+// Bytes held by a level, by entity kind. Containers are counted by capacity.
+struct LevelMemory {
+	MemoryUsage cells, monsters, plans, inventory_items, items, objects, object_items;
+	size_t total() const;
+};
+
+LevelMemory measure_level(const Chthon::Level & level);
+size_t estimate_level_memory(const Chthon::Level & level);
+
+struct MemoryReport {
+	std::map<int, LevelMemory> levels;
+	MemoryUsage paged_levels, messages, travel;
+
+	void add_game(const Chthon::Game & game, const LevelPager * pager);
+	void add_console(const Console & console);
+	std::vector<std::string> lines() const;
+};
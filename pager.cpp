@@ -0,0 +1,211 @@
+#include "pager.h"
+#include "savefile.h"
+#include "memory.h"
+#include "generate.h"
+#include <chthon/game.h>
+#include <chthon/level.h>
+#include <chthon/files.h>
+#include <chthon/log.h>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+using namespace Chthon;
+
+LevelPager::LevelPager()
+	: budget(0)
+{
+}
+
+LevelPager::~LevelPager()
+{
+	if(is_enabled()) {
+		scratch.close();
+		remove(filename.c_str());
+	}
+}
+
+void LevelPager::configure(const std::string & scratch_filename, size_t memory_budget)
+{
+	filename = scratch_filename;
+	budget = memory_budget;
+	pages.clear();
+	free_ranges.clear();
+	scratch.close();
+	scratch.open(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!scratch) {
+		log("Cannot open scratch file '{0}', level paging is disabled.", filename);
+		filename.clear();
+	}
+}
+
+void LevelPager::touch(int level_index)
+{
+	recent.remove(level_index);
+	recent.push_front(level_index);
+}
+
+// First free range that fits, or the end of file.
+std::streamoff LevelPager::allocate(size_t size)
+{
+	typedef std::map<std::streamoff, size_t>::iterator Range;
+	for(Range range = free_ranges.begin(); range != free_ranges.end(); ++range) {
+		if(range->second >= size) {
+			std::streamoff offset = range->first;
+			size_t rest = range->second - size;
+			free_ranges.erase(range);
+			if(rest > 0) {
+				free_ranges[offset + std::streamoff(size)] = rest;
+			}
+			return offset;
+		}
+	}
+	scratch.seekp(0, std::ios::end);
+	return scratch.tellp();
+}
+
+void LevelPager::release(const Page & page)
+{
+	typedef std::map<std::streamoff, size_t>::iterator Range;
+	std::streamoff offset = page.offset;
+	size_t size = page.size;
+	Range next = free_ranges.lower_bound(offset);
+	if(next != free_ranges.end() && next->first == offset + std::streamoff(size)) {
+		size += next->second;
+		free_ranges.erase(next++);
+	}
+	if(next != free_ranges.begin()) {
+		Range previous = next;
+		--previous;
+		if(previous->first + std::streamoff(previous->second) == offset) {
+			offset = previous->first;
+			size += previous->second;
+			free_ranges.erase(previous);
+		}
+	}
+	free_ranges[offset] = size;
+}
+
+size_t LevelPager::paged_size(int level_index) const
+{
+	std::map<int, Page>::const_iterator page = pages.find(level_index);
+	return (page == pages.end()) ? 0 : page->second.size;
+}
+
+std::vector<int> LevelPager::paged_levels() const
+{
+	std::vector<int> result;
+	for(std::map<int, Page>::const_iterator page = pages.begin(); page != pages.end(); ++page) {
+		result.push_back(page->first);
+	}
+	return result;
+}
+
+bool LevelPager::read_page(int level_index, std::string & data) const
+{
+	std::map<int, Page>::const_iterator page = pages.find(level_index);
+	if(page == pages.end()) {
+		return false;
+	}
+	data.assign(page->second.size, '\0');
+	scratch.clear();
+	scratch.seekg(page->second.offset);
+	scratch.read(&data[0], std::streamsize(data.size()));
+	if(!scratch) {
+		log("Cannot read level {0} from scratch file.", level_index);
+		return false;
+	}
+	return true;
+}
+
+bool LevelPager::page_in(const LinearDungeon & game, Level & level, int level_index)
+{
+	std::string data;
+	if(!read_page(level_index, data)) {
+		return false;
+	}
+	try {
+		std::istringstream in(data);
+		Reader reader(in);
+		load_level(reader, game, level_index, level);
+	} catch(const Reader::Exception & e) {
+		log(e.message);
+		return false;
+	}
+	release(pages[level_index]);
+	pages.erase(level_index);
+	if(pages.empty()) {
+		free_ranges.clear();
+		scratch.close();
+		scratch.open(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	}
+	touch(level_index);
+	log("Level {0} is paged in.", level_index);
+	return true;
+}
+
+void LevelPager::page_out(LinearDungeon & game, int level_index)
+{
+	std::ostringstream out;
+	try {
+		Writer writer(out);
+		save_level(writer, game, level_index, game.levels[level_index]);
+	} catch(const Writer::Exception & e) {
+		log(e.message);
+		return;
+	}
+	std::string data = out.str();
+	scratch.clear();
+	Page page;
+	page.offset = allocate(data.size());
+	page.size = data.size();
+	scratch.seekp(page.offset);
+	scratch.write(data.data(), std::streamsize(data.size()));
+	scratch.flush();
+	if(!scratch) {
+		log("Cannot write level {0} to scratch file.", level_index);
+		release(page);
+		return;
+	}
+	pages[level_index] = page;
+	game.levels.erase(level_index);
+	game.travel_planner.forget(level_index);
+	recent.remove(level_index);
+	log("Level {0} is paged out.", level_index);
+}
+
+void LevelPager::enforce_budget(LinearDungeon & game)
+{
+	if(!is_enabled()) {
+		return;
+	}
+	touch(game.current_level_index);
+	size_t resident = 0;
+	for(std::map<int, Level>::const_iterator level = game.levels.begin(); level != game.levels.end(); ++level) {
+		resident += estimate_level_memory(level->second);
+	}
+	while(resident > budget) {
+		int victim = game.current_level_index;
+		for(std::map<int, Level>::const_iterator level = game.levels.begin(); level != game.levels.end(); ++level) {
+			if(std::find(recent.begin(), recent.end(), level->first) == recent.end()) {
+				victim = level->first;
+				break;
+			}
+		}
+		if(victim == game.current_level_index) {
+			for(std::list<int>::const_reverse_iterator index = recent.rbegin(); index != recent.rend(); ++index) {
+				if(*index != game.current_level_index && game.levels.count(*index) > 0) {
+					victim = *index;
+					break;
+				}
+			}
+		}
+		if(victim == game.current_level_index) {
+			break;
+		}
+		resident -= estimate_level_memory(game.levels[victim]);
+		page_out(game, victim);
+		if(game.levels.count(victim) > 0) {
+			break;
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <map>
+#include <list>
+#include <vector>
+namespace Chthon {
+	class Level;
+}
+class LinearDungeon;
+
+// Keeps resident levels within a memory budget by moving least recently
+// visited ones into a scratch file, serialized the same way as in savefile
+// (as a delta against the regenerated level).
+// Paged out levels are loaded back when game asks to generate them again.
+// Space of paged in levels is reused by later pages, so scratch file does
+// not grow while the same levels go in and out.
+class LevelPager {
+public:
+	LevelPager();
+	~LevelPager();
+	void configure(const std::string & scratch_filename, size_t memory_budget);
+	bool is_enabled() const { return !filename.empty(); }
+
+	bool page_in(const LinearDungeon & game, Chthon::Level & level, int level_index);
+	void enforce_budget(LinearDungeon & game);
+	std::vector<int> paged_levels() const;
+	size_t paged_size(int level_index) const;
+	// Level record exactly as save_level wrote it.
+	bool read_page(int level_index, std::string & data) const;
+private:
+	struct Page {
+		std::streamoff offset;
+		size_t size;
+	};
+	std::string filename;
+	size_t budget;
+	mutable std::fstream scratch;
+	std::map<int, Page> pages;
+	// Unused ranges of scratch file: offset -> size, adjacent ones merged.
+	std::map<std::streamoff, size_t> free_ranges;
+	std::list<int> recent;
+	void touch(int level_index);
+	std::streamoff allocate(size_t size);
+	void release(const Page & page);
+	void page_out(LinearDungeon & game, int level_index);
+};
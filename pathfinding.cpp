@@ -0,0 +1,374 @@
+#include "pathfinding.h"
+#include <chthon/game.h>
+#include <chthon/level.h>
+#include <chthon/objects.h>
+#include <chthon/cell.h>
+#include <chthon/log.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <list>
+#include <climits>
+using namespace Chthon;
+
+static const Point NEIGHBOURS[] = {
+	Point(-1, -1), Point( 0, -1), Point( 1, -1),
+	Point(-1,  0),                Point( 1,  0),
+	Point(-1,  1), Point( 0,  1), Point( 1,  1),
+};
+
+static Point neighbour(const Point & pos, unsigned direction)
+{
+	return Point(pos.x + NEIGHBOURS[direction].x, pos.y + NEIGHBOURS[direction].y);
+}
+
+RoomGraph::RoomGraph()
+	: width(0), height(0), regions(0)
+{
+}
+
+int RoomGraph::region_at(const Point & pos) const
+{
+	if(pos.x < 0 || pos.y < 0 || pos.x >= int(width) || pos.y >= int(height)) {
+		return NO_REGION;
+	}
+	return cell_regions[unsigned(pos.x) + unsigned(pos.y) * width];
+}
+
+std::vector<int> RoomGraph::regions_of(const Point & pos) const
+{
+	int region = region_at(pos);
+	if(region >= 0) {
+		return std::vector<int>(1, region);
+	}
+	if(region == DOOR) {
+		return doors[door_at.find(pos)->second].regions;
+	}
+	return std::vector<int>();
+}
+
+void RoomGraph::build(const Level & level)
+{
+	width = level.map.width;
+	height = level.map.height;
+	regions = 0;
+	doors.clear();
+	door_at.clear();
+	cell_regions.assign(width * height, NO_REGION);
+	distance.assign(width * height, UINT_MAX);
+	reached.clear();
+
+	std::vector<bool> passable(width * height, false);
+	for(int y = 0; y < int(height); ++y) {
+		for(int x = 0; x < int(width); ++x) {
+			passable[unsigned(x) + unsigned(y) * width] = level.map.cell(x, y).type->passable;
+		}
+	}
+	foreach(const Object & object, level.objects) {
+		if(!level.map.valid(object.pos)) {
+			continue;
+		}
+		unsigned index = unsigned(object.pos.x) + unsigned(object.pos.y) * width;
+		if(object.type->openable) {
+			cell_regions[index] = DOOR;
+			Door door;
+			door.pos = object.pos;
+			door_at[object.pos] = unsigned(doors.size());
+			doors.push_back(door);
+		} else if(!object.is_passable()) {
+			passable[index] = false;
+		}
+	}
+
+	for(int y = 0; y < int(height); ++y) {
+		for(int x = 0; x < int(width); ++x) {
+			unsigned index = unsigned(x) + unsigned(y) * width;
+			if(!passable[index] || cell_regions[index] != NO_REGION) {
+				continue;
+			}
+			int region = int(regions++);
+			std::queue<Point> queue;
+			cell_regions[index] = region;
+			queue.push(Point(x, y));
+			while(!queue.empty()) {
+				Point pos = queue.front();
+				queue.pop();
+				for(unsigned i = 0; i < 8; ++i) {
+					Point next = neighbour(pos, i);
+					if(!level.map.valid(next)) {
+						continue;
+					}
+					unsigned next_index = unsigned(next.x) + unsigned(next.y) * width;
+					if(passable[next_index] && cell_regions[next_index] == NO_REGION) {
+						cell_regions[next_index] = region;
+						queue.push(next);
+					}
+				}
+			}
+		}
+	}
+
+	foreach(Door & door, doors) {
+		for(unsigned i = 0; i < 8; ++i) {
+			int region = region_at(neighbour(door.pos, i));
+			if(region >= 0 && std::find(door.regions.begin(), door.regions.end(), region) == door.regions.end()) {
+				door.regions.push_back(region);
+			}
+		}
+	}
+	foreach(Door & door, doors) {
+		foreach(int region, door.regions) {
+			spread(door.pos, region);
+			foreach(const Point & cell, reached) {
+				if(cell == door.pos || region_at(cell) != DOOR) {
+					continue;
+				}
+				Edge edge;
+				edge.door = door_at[cell];
+				edge.cost = distance_at(cell);
+				edge.region = region;
+				door.edges.push_back(edge);
+			}
+		}
+	}
+	log("Room graph: {0} regions, {1} doors.", regions, doors.size());
+}
+
+// Breadth-first distances from origin over cells of region.
+// Doors around the region are reached but not passed through.
+void RoomGraph::spread(const Point & origin, int region) const
+{
+	foreach(const Point & pos, reached) {
+		distance[unsigned(pos.x) + unsigned(pos.y) * width] = UINT_MAX;
+	}
+	reached.clear();
+	if(region_at(origin) == NO_REGION) {
+		return;
+	}
+	distance[unsigned(origin.x) + unsigned(origin.y) * width] = 0;
+	reached.push_back(origin);
+	// Reached cells are the queue itself.
+	for(unsigned head = 0; head < reached.size(); ++head) {
+		Point pos = reached[head];
+		if(head > 0 && region_at(pos) != region) {
+			continue;
+		}
+		unsigned next_distance = distance_at(pos) + 1;
+		for(unsigned i = 0; i < 8; ++i) {
+			Point next = neighbour(pos, i);
+			int next_region = region_at(next);
+			if(next_region != region && next_region != DOOR) {
+				continue;
+			}
+			unsigned & next_cell = distance[unsigned(next.x) + unsigned(next.y) * width];
+			if(next_cell == UINT_MAX) {
+				next_cell = next_distance;
+				reached.push_back(next);
+			}
+		}
+	}
+}
+
+unsigned RoomGraph::distance_at(const Point & pos) const
+{
+	if(pos.x < 0 || pos.y < 0 || pos.x >= int(width) || pos.y >= int(height)) {
+		return UINT_MAX;
+	}
+	return distance[unsigned(pos.x) + unsigned(pos.y) * width];
+}
+
+bool RoomGraph::is_open(const Level & level, unsigned door) const
+{
+	const Object & object = find_at(level.objects, doors[door].pos);
+	if(!object.valid()) {
+		return level.map.cell(doors[door].pos).type->passable;
+	}
+	if(object.type->openable) {
+		return !object.locked;
+	}
+	return object.is_passable();
+}
+
+// Appends steps of the shortest way from one point to another within region.
+bool RoomGraph::refine(const Point & from, const Point & to, int region, std::vector<Point> & steps) const
+{
+	spread(to, region);
+	unsigned current = distance_at(from);
+	if(current == UINT_MAX) {
+		return false;
+	}
+	Point pos = from;
+	while(!(pos == to)) {
+		bool found = false;
+		for(unsigned i = 0; i < 8 && !found; ++i) {
+			Point next = neighbour(pos, i);
+			if(!(next == to) && region_at(next) != region) {
+				continue;
+			}
+			unsigned next_distance = distance_at(next);
+			if(next_distance != UINT_MAX && next_distance + 1 == current) {
+				steps.push_back(NEIGHBOURS[i]);
+				pos = next;
+				current = next_distance;
+				found = true;
+			}
+		}
+		if(!found) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::vector<Point> RoomGraph::find_path(const Level & level, const Point & start, const Point & target) const
+{
+	std::vector<Point> steps;
+	if(width != level.map.width || height != level.map.height || start == target) {
+		return steps;
+	}
+	std::vector<int> start_regions = regions_of(start);
+	std::vector<int> target_regions = regions_of(target);
+	if(start_regions.empty() || target_regions.empty()) {
+		return steps;
+	}
+
+	foreach(int region, start_regions) {
+		if(std::find(target_regions.begin(), target_regions.end(), region) != target_regions.end()) {
+			if(refine(start, target, region, steps)) {
+				std::reverse(steps.begin(), steps.end());
+				return steps;
+			}
+			steps.clear();
+		}
+	}
+
+	// Search over doors; node past the last door is the target.
+	const unsigned goal = unsigned(doors.size());
+	std::vector<unsigned> cost(goal + 1, UINT_MAX);
+	std::vector<int> previous(goal + 1, -1);
+	std::vector<int> via(goal + 1, NO_REGION);
+	typedef std::pair<unsigned, unsigned> Node;
+	std::priority_queue<Node, std::vector<Node>, std::greater<Node> > queue;
+
+	foreach(int region, start_regions) {
+		spread(start, region);
+		foreach(const Point & cell, reached) {
+			if(cell == start || region_at(cell) != DOOR) {
+				continue;
+			}
+			unsigned door = door_at.find(cell)->second;
+			if(is_open(level, door) && distance_at(cell) < cost[door]) {
+				cost[door] = distance_at(cell);
+				via[door] = region;
+				queue.push(Node(cost[door], door));
+			}
+		}
+	}
+	std::map<unsigned, std::pair<unsigned, int> > to_target;
+	foreach(int region, target_regions) {
+		spread(target, region);
+		foreach(const Point & cell, reached) {
+			if(cell == target || region_at(cell) != DOOR) {
+				continue;
+			}
+			unsigned door = door_at.find(cell)->second;
+			if(to_target.count(door) == 0 || distance_at(cell) < to_target[door].first) {
+				to_target[door] = std::make_pair(distance_at(cell), region);
+			}
+		}
+	}
+
+	while(!queue.empty()) {
+		Node node = queue.top();
+		queue.pop();
+		if(node.first > cost[node.second]) {
+			continue;
+		}
+		if(node.second == goal) {
+			break;
+		}
+		unsigned door = node.second;
+		std::map<unsigned, std::pair<unsigned, int> >::const_iterator last_leg = to_target.find(door);
+		if(last_leg != to_target.end() && node.first + last_leg->second.first < cost[goal]) {
+			cost[goal] = node.first + last_leg->second.first;
+			previous[goal] = int(door);
+			via[goal] = last_leg->second.second;
+			queue.push(Node(cost[goal], goal));
+		}
+		foreach(const Edge & edge, doors[door].edges) {
+			if(node.first + edge.cost < cost[edge.door] && is_open(level, edge.door)) {
+				cost[edge.door] = node.first + edge.cost;
+				previous[edge.door] = int(door);
+				via[edge.door] = edge.region;
+				queue.push(Node(cost[edge.door], edge.door));
+			}
+		}
+	}
+	if(cost[goal] == UINT_MAX) {
+		return steps;
+	}
+
+	std::vector<unsigned> route;
+	for(int node = int(goal); node >= 0; node = previous[unsigned(node)]) {
+		route.push_back(unsigned(node));
+	}
+	std::reverse(route.begin(), route.end());
+	Point from = start;
+	foreach(unsigned node, route) {
+		Point to = (node == goal) ? target : doors[node].pos;
+		if(!refine(from, to, via[node], steps)) {
+			steps.clear();
+			return steps;
+		}
+		from = to;
+	}
+	std::reverse(steps.begin(), steps.end());
+	return steps;
+}
+
+
+void TravelPlanner::prepare(const Level & level, int level_index)
+{
+	graphs[level_index].build(level);
+}
+
+void TravelPlanner::forget(int level_index)
+{
+	graphs.erase(level_index);
+}
+
+// Graph is built from cells and objects, which actions (e.g. explosions)
+// may change; steps should not lead through anything impassable now.
+static bool is_walkable(const Level & level, const Point & start, const std::vector<Point> & steps)
+{
+	Point pos = start;
+	for(std::vector<Point>::const_reverse_iterator shift = steps.rbegin(); shift != steps.rend(); ++shift) {
+		pos = pos + *shift;
+		const Object & object = find_at(level.objects, pos);
+		if(object.valid() ? !(object.is_passable() || object.type->openable) : !level.map.cell(pos).type->passable) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::vector<Point> TravelPlanner::find_path(const Game & game, const Point & start, const Point & target)
+{
+	const Level & level = game.current_level();
+	std::map<int, RoomGraph>::const_iterator graph = graphs.find(game.current_level_index);
+	if(graph == graphs.end()) {
+		prepare(level, game.current_level_index);
+		graph = graphs.find(game.current_level_index);
+	}
+	std::vector<Point> steps = graph->second.find_path(level, start, target);
+	if(!steps.empty() && !is_walkable(level, start, steps)) {
+		log("Room graph of level {0} is stale, rebuilding.", game.current_level_index);
+		prepare(level, game.current_level_index);
+		steps = graph->second.find_path(level, start, target);
+	}
+	if(steps.empty()) {
+		std::list<Point> path = level.find_path(start, target);
+		steps.assign(path.rbegin(), path.rend());
+	}
+	return steps;
+}
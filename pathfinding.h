@@ -0,0 +1,67 @@
+#pragma once
+#include <chthon/point.h>
+#include <vector>
+#include <map>
+namespace Chthon {
+	class Game;
+	class Level;
+}
+
+// Abstract graph of a level: regions of passable cells (rooms, corridors)
+// separated by doors. Distances between doors of the same region are
+// precomputed, so a long path is searched over doors first and only the
+// legs inside single regions are refined cell by cell.
+// Door state is not a part of the graph, it is checked at query time:
+// opened and closed doors are passable, locked ones are not.
+class RoomGraph {
+public:
+	RoomGraph();
+	void build(const Chthon::Level & level);
+	// Steps from start to target, next step at the back.
+	// Empty if either point is not in a region or there is no path.
+	std::vector<Chthon::Point> find_path(const Chthon::Level & level, const Chthon::Point & start, const Chthon::Point & target) const;
+	unsigned region_count() const { return regions; }
+	unsigned door_count() const { return unsigned(doors.size()); }
+private:
+	enum { NO_REGION = -1, DOOR = -2 };
+	struct Edge {
+		unsigned door;
+		unsigned cost;
+		int region;
+	};
+	struct Door {
+		Chthon::Point pos;
+		std::vector<int> regions;
+		std::vector<Edge> edges;
+	};
+	unsigned width, height;
+	unsigned regions;
+	std::vector<int> cell_regions;
+	std::vector<Door> doors;
+	std::map<Chthon::Point, unsigned> door_at;
+	// Distances of the last search by cell, UNREACHED elsewhere. Cells it
+	// reached are listed, so the next search resets only them.
+	mutable std::vector<unsigned> distance;
+	mutable std::vector<Chthon::Point> reached;
+
+	int region_at(const Chthon::Point & pos) const;
+	std::vector<int> regions_of(const Chthon::Point & pos) const;
+	bool is_open(const Chthon::Level & level, unsigned door) const;
+	void spread(const Chthon::Point & origin, int region) const;
+	unsigned distance_at(const Chthon::Point & pos) const;
+	bool refine(const Chthon::Point & from, const Chthon::Point & to, int region, std::vector<Chthon::Point> & steps) const;
+};
+
+// Room graphs of levels, built when level is generated or on first use.
+// Graph of a paged out level is forgotten; graph which leads through cells
+// that are no longer passable is rebuilt.
+class TravelPlanner {
+public:
+	void prepare(const Chthon::Level & level, int level_index);
+	void forget(int level_index);
+	// Steps for player to travel on current level, next step at the back.
+	// Falls back to plain Level::find_path when graph has no answer.
+	std::vector<Chthon::Point> find_path(const Chthon::Game & game, const Chthon::Point & start, const Chthon::Point & target);
+private:
+	std::map<int, RoomGraph> graphs;
+};
@@ -1,22 +1,124 @@
 #include "player.h"
 #include "console.h"
+#include "pool.h"
+#include "memory.h"
+#include "pathfinding.h"
+#include "stacks.h"
+#include <vector>
 #include <chthon/game.h>
 #include <chthon/actions.h>
 using namespace Chthon;
 
 PlayerControl::PlayerControl(TempleUI & console)
-	: interface(console)
+	: pager(nullptr), planner(nullptr), stacks(nullptr), travel_opens_doors(false), interface(console), opening_door(false)
 {
 }
 
+void PlayerControl::report_memory(MemoryReport & report, const Game & game) const
+{
+	report.add_game(game, pager);
+	report.add_console(interface);
+	const Monster & player = game.current_level().get_player();
+	if(player.valid()) {
+		report.travel.add(unsigned(route.size()), route.capacity() * sizeof(Point) + player.plan.size() * (sizeof(Action*) + sizeof(Pooled<Move>)));
+	}
+}
+
+// Travel is stored as a path of steps; Monster::plan holds one pooled
+// action for the next step only, so Chthon interrupts it like any plan.
+// Closed doors on the way are opened only when asked to (--travel-opens-doors),
+// otherwise travel bumps into them as it always did.
+void PlayerControl::set_travel(Monster & player, const Game & game, const Point & target)
+{
+	route.clear();
+	opening_door = false;
+	if(target.null()) {
+		return;
+	}
+	if(planner) {
+		route = planner->find_path(game, player.pos, target);
+	} else {
+		auto path = game.current_level().find_path(player.pos, target);
+		route.assign(path.rbegin(), path.rend());
+	}
+	route_pos = player.pos;
+	queue_travel_step(player, game);
+}
+
+void PlayerControl::queue_travel_step(Monster & player, const Game & game)
+{
+	if(route.empty()) {
+		return;
+	}
+	Point shift = route.back();
+	if(travel_opens_doors && !opening_door) {
+		const Object & door = find_at(game.current_level().objects, route_pos + shift);
+		if(door.valid() && door.type->openable && !door.opened()) {
+			// Move follows once door is opened.
+			player.plan.push_back(new Pooled<Open>(shift));
+			opening_door = true;
+			return;
+		}
+	}
+	player.plan.push_back(new Pooled<Move>(shift));
+	opening_door = false;
+	route.pop_back();
+	route_pos = route_pos + shift;
+}
+
+// Grab takes the first item under player, so whole stack is grabbed
+// by as many grabs as there are items of its kind in a row.
+Action * PlayerControl::grab_stack(Monster & player, const Game & game)
+{
+	if(stacks) {
+		const Item * first = nullptr;
+		foreach(const Item & item, game.current_level().items) {
+			if(!(item.pos == player.pos)) {
+				continue;
+			}
+			if(!first) {
+				first = &item;
+				if(!stacks->is_stackable(item)) {
+					break;
+				}
+			} else if(ItemStacks::same_kind(item, *first)) {
+				player.plan.push_back(new Pooled<Grab>());
+			} else {
+				break;
+			}
+		}
+	}
+	return new Pooled<Grab>();
+}
+
+// Inventory shows a stack as one slot, dropping it drops every item of it.
+Action * PlayerControl::drop_stack(Monster & player, unsigned slot)
+{
+	if(stacks) {
+		std::vector<unsigned> slots = stacks->stack_slots(player.inventory, slot);
+		for(unsigned i = 1; i < slots.size(); ++i) {
+			player.plan.push_back(new Pooled<Drop>(slots[i]));
+		}
+	}
+	return new Pooled<Drop>(slot);
+}
+
 Action * PlayerControl::act(Monster & player, Game & game)
 {
 	while(game.state == Game::PLAYING) {
+		if(player.plan.empty() && !route.empty()) {
+			// Next step was discarded along with the plan.
+			route.clear();
+			opening_door = false;
+		}
 		if(!player.plan.empty()) {
 			interface.draw_game(game);
 			delay(10);
 			Action * action = player.plan.front();
 			player.plan.pop_front();
+			if(player.plan.empty()) {
+				queue_travel_step(player, game);
+			}
 			return action;
 		}
 		int ch = interface.draw_and_get_control(game);
@@ -29,50 +131,58 @@ Action * PlayerControl::act(Monster & player, Game & game)
 				game.state = Game::SUSPENDED;
 				break;
 			case 'x':
-				player.add_path(game.current_level().find_path(player.pos, interface.target_mode(game, player.pos)));
+				set_travel(player, game, interface.target_mode(game, player.pos));
 				break;
 			case 'i':
 				interface.draw_inventory(game, player);
 				interface.get_control();
 				break;
+			case 'M':
+			{
+				MemoryReport report;
+				report_memory(report, game);
+				interface.draw_text(report.lines());
+				interface.get_control();
+				break;
+			}
 			case 'h': case 'j': case 'k': case 'l': case 'y': case 'u': case 'b': case 'n':
 			{
 				Point shift = interface.directions[ch];
 				Point new_pos = player.pos + shift;
 				if(find_at(game.current_level().monsters, new_pos).valid()) {
-					return new Swing(shift);
+					return new Pooled<Swing>(shift);
 				}
 				Object & object = find_at(game.current_level().objects, new_pos);
 				if(object.valid()) {
 					if(object.type->openable && !object.opened()) {
-						player.plan.push_front(new Move(shift));
-						return new Open(shift);
+						player.plan.push_front(new Pooled<Move>(shift));
+						return new Pooled<Open>(shift);
 					}
 					if(object.type->containable) {
-						return new Open(shift);
+						return new Pooled<Open>(shift);
 					}
 					if(object.type->drinkable) {
-						return new Drink(shift);
+						return new Pooled<Drink>(shift);
 					}
 				}
-				return new Move(shift);
+				return new Pooled<Move>(shift);
 			}
-			case '<': return new GoUp();
-			case '>': return new GoDown();
-			case 'g': return new Grab();
-			case 'w': return new Wield(interface.get_inventory_slot(game, player));
-			case 'W': return new Wear(interface.get_inventory_slot(game, player));
-			case 't': return new Unwield();
-			case 'T': return new TakeOff();
-			case 'e': return new Eat(interface.get_inventory_slot(game, player));
-			case 'd': return new Drop(interface.get_inventory_slot(game, player));
-			case '.': return new Wait();
-			case 'D': return new Drink(interface.draw_and_get_direction(game));
-			case 'f': return new Fire(interface.draw_and_get_direction(game));
-			case 'p': return new Put(interface.draw_and_get_direction(game));
-			case 's': return new Swing(interface.draw_and_get_direction(game));
-			case 'o': return new Open(interface.draw_and_get_direction(game));
-			case 'c': return new Close(interface.draw_and_get_direction(game));
+			case '<': return new Pooled<GoUp>();
+			case '>': return new Pooled<GoDown>();
+			case 'g': return grab_stack(player, game);
+			case 'w': return new Pooled<Wield>(interface.get_inventory_slot(game, player));
+			case 'W': return new Pooled<Wear>(interface.get_inventory_slot(game, player));
+			case 't': return new Pooled<Unwield>();
+			case 'T': return new Pooled<TakeOff>();
+			case 'e': return new Pooled<Eat>(interface.get_inventory_slot(game, player));
+			case 'd': return drop_stack(player, interface.get_inventory_slot(game, player));
+			case '.': return new Pooled<Wait>();
+			case 'D': return new Pooled<Drink>(interface.draw_and_get_direction(game));
+			case 'f': return new Pooled<Fire>(interface.draw_and_get_direction(game));
+			case 'p': return new Pooled<Put>(interface.draw_and_get_direction(game));
+			case 's': return new Pooled<Swing>(interface.draw_and_get_direction(game));
+			case 'o': return new Pooled<Open>(interface.draw_and_get_direction(game));
+			case 'c': return new Pooled<Close>(interface.draw_and_get_direction(game));
 			default: interface.set_notification(format("Unknown control '{0}'", char(ch)));
 		}
 	}
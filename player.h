@@ -1,17 +1,40 @@
 #pragma once
 #include <chthon/ai.h>
+#include <chthon/point.h>
+#include <vector>
 namespace Chthon {
 	class Action;
 	class Monster;
 	class Game;
 }
 class TempleUI;
+class LevelPager;
+class TravelPlanner;
+class ItemStacks;
+struct MemoryReport;
 
 class PlayerControl : public Chthon::Controller {
 public:
+	const LevelPager * pager;
+	TravelPlanner * planner;
+	const ItemStacks * stacks;
+	bool travel_opens_doors;
+
 	PlayerControl(TempleUI & console);
 	virtual Chthon::Action * act(Chthon::Monster & player, Chthon::Game & game);
+	void report_memory(MemoryReport & report, const Chthon::Game & game) const;
 private:
 	TempleUI & interface;
+	// Steps of current travel, next one at the back. Only the next step
+	// is queued in Monster::plan, so when Chthon interrupts the plan
+	// the travel ends with it.
+	std::vector<Chthon::Point> route;
+	Chthon::Point route_pos;
+	bool opening_door;
+
+	void set_travel(Chthon::Monster & player, const Chthon::Game & game, const Chthon::Point & target);
+	void queue_travel_step(Chthon::Monster & player, const Chthon::Game & game);
+	Chthon::Action * grab_stack(Chthon::Monster & player, const Chthon::Game & game);
+	Chthon::Action * drop_stack(Chthon::Monster & player, unsigned slot);
 };
 
@@ -0,0 +1,38 @@
+#include "players.h"
+
+PlayerTable::Handle PlayerTable::enter(const std::string & name, unsigned session_id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if(by_name.count(name) > 0) {
+		return Handle();
+	}
+	Player player;
+	player.name = name;
+	player.session_id = session_id;
+	Handle handle = players.insert(player);
+	by_name[name] = handle;
+	return handle;
+}
+
+unsigned PlayerTable::leave(const Handle & handle)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	const Player * player = players.get(handle);
+	if(player) {
+		by_name.erase(player->name);
+		players.remove(handle);
+	}
+	return players.size();
+}
+
+bool PlayerTable::contains(const Handle & handle) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return players.contains(handle);
+}
+
+unsigned PlayerTable::size() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return players.size();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "slotmap.h"
+#include <string>
+#include <map>
+#include <mutex>
+
+// Players currently in the Temple, one per name, shared by all sessions.
+// Session keeps the handle it got on entering and leaves with it; handle
+// of a player who has already left is stale and changes nothing.
+class PlayerTable {
+public:
+	struct Player {
+		std::string name;
+		unsigned session_id;
+	};
+	typedef SlotMap<Player>::Handle Handle;
+
+	// Null handle if player with this name is already in.
+	Handle enter(const std::string & name, unsigned session_id);
+	// Number of players remaining.
+	unsigned leave(const Handle & handle);
+	bool contains(const Handle & handle) const;
+	unsigned size() const;
+private:
+	mutable std::mutex mutex;
+	SlotMap<Player> players;
+	std::map<std::string, Handle> by_name;
+};
@@ -0,0 +1,36 @@
+#include "pool.h"
+#include <algorithm>
+
+FreeList::FreeList(size_t list_block_size)
+	: block_size(std::max(list_block_size, sizeof(Node))), head(nullptr)
+{
+	block_size = (block_size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+}
+
+FreeList::~FreeList()
+{
+	for(unsigned i = 0; i < chunks.size(); ++i) {
+		delete [] chunks[i];
+	}
+}
+
+void * FreeList::allocate()
+{
+	if(!head) {
+		char * chunk = new char[block_size * BLOCKS_PER_CHUNK];
+		chunks.push_back(chunk);
+		for(unsigned i = 0; i < BLOCKS_PER_CHUNK; ++i) {
+			deallocate(chunk + i * block_size);
+		}
+	}
+	Node * block = head;
+	head = head->next;
+	return block;
+}
+
+void FreeList::deallocate(void * block)
+{
+	Node * node = static_cast<Node*>(block);
+	node->next = head;
+	head = node;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Free list of fixed-size blocks. Memory is taken in chunks and reused,
+// so steady allocation does not reach the general-purpose allocator.
+class FreeList {
+public:
+	enum { BLOCKS_PER_CHUNK = 64 };
+	FreeList(size_t list_block_size);
+	~FreeList();
+	void * allocate();
+	void deallocate(void * block);
+private:
+	struct Node {
+		Node * next;
+	};
+	size_t block_size;
+	Node * head;
+	std::vector<char*> chunks;
+	FreeList(const FreeList &);
+	FreeList & operator=(const FreeList &);
+};
+
+// Object (usually an Action) that lives in a per-thread pool of its type.
+// It is created with plain new and deleted by its owner as usual:
+// virtual destructor routes deletion back into the pool.
+template<class T>
+class Pooled : public T {
+public:
+	template<class... Args>
+		Pooled(Args&&... args) : T(std::forward<Args>(args)...) {}
+	virtual ~Pooled() {}
+	static void * operator new(size_t size)
+	{
+		return (size == sizeof(Pooled)) ? pool().allocate() : ::operator new(size);
+	}
+	static void operator delete(void * block, size_t size)
+	{
+		if(size == sizeof(Pooled)) {
+			pool().deallocate(block);
+		} else {
+			::operator delete(block);
+		}
+	}
+private:
+	static FreeList & pool()
+	{
+		static thread_local FreeList list(sizeof(Pooled));
+		return list;
+	}
+};
@@ -0,0 +1,363 @@
+#include "recording.h"
+#include <chthon/log.h>
+#include <algorithm>
+using namespace Chthon;
+
+// File layout:
+//   header: "TTRC", version byte, varint width, varint height;
+//   frame: kind byte, varint milliseconds since previous frame,
+//          varint payload size, payload.
+// Keyframe payload is a list of (varint run length, glyph) until the
+// screen is filled. Diff payload is a varint run count followed by
+// (varint cells skipped, varint run length, glyphs...) for every run.
+// Glyph is stored as two bytes: character and attributes.
+static const char RECORDING_MAGIC[] = "TTRC";
+enum { RECORDING_VERSION = 1 };
+enum { FRAME_DIFF = 0, FRAME_KEY = 1 };
+enum { MAX_PLAYBACK_DELAY = 1000, PLAYBACK_TICK = 10 };
+
+static void put_varint(std::string & out, unsigned value)
+{
+	while(value >= 0x80) {
+		out += char((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	out += char(value);
+}
+
+static bool get_varint(const std::string & in, size_t & pos, unsigned & value)
+{
+	value = 0;
+	for(unsigned shift = 0; pos < in.size() && shift < 32; shift += 7) {
+		unsigned char byte = (unsigned char)in[pos++];
+		value |= unsigned(byte & 0x7f) << shift;
+		if((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void put_glyph(std::string & out, const Glyph & glyph)
+{
+	out += char(glyph.ch);
+	out += char(glyph.attrs);
+}
+
+static bool get_glyph(const std::string & in, size_t & pos, Glyph & glyph)
+{
+	if(pos + 2 > in.size()) {
+		return false;
+	}
+	glyph = Glyph((unsigned char)in[pos], (unsigned char)in[pos + 1]);
+	pos += 2;
+	return true;
+}
+
+Recorder::Recorder(const std::string & filename)
+	: out(filename.c_str(), std::ios::out | std::ios::binary), width(0), height(0),
+	frames_since_keyframe(KEYFRAME_INTERVAL), last_time(std::chrono::steady_clock::now()), last_flush(last_time)
+{
+	if(!out) {
+		log("Cannot write recording to '{0}'.", filename);
+	}
+}
+
+void Recorder::start(unsigned screen_width, unsigned screen_height)
+{
+	width = screen_width;
+	height = screen_height;
+	last_time = std::chrono::steady_clock::now();
+	std::string header(RECORDING_MAGIC, 4);
+	header += char(RECORDING_VERSION);
+	put_varint(header, width);
+	put_varint(header, height);
+	out.write(header.data(), std::streamsize(header.size()));
+}
+
+void Recorder::encode_keyframe(const std::vector<Glyph> & screen)
+{
+	payload.clear();
+	for(size_t i = 0; i < screen.size(); ) {
+		size_t run = 1;
+		while(i + run < screen.size() && screen[i + run] == screen[i]) {
+			++run;
+		}
+		put_varint(payload, unsigned(run));
+		put_glyph(payload, screen[i]);
+		i += run;
+	}
+}
+
+bool Recorder::encode_diff(const std::vector<Glyph> & screen)
+{
+	payload.clear();
+	std::string runs;
+	unsigned run_count = 0;
+	size_t last_end = 0;
+	for(size_t i = 0; i < screen.size(); ) {
+		if(screen[i] == previous[i]) {
+			++i;
+			continue;
+		}
+		size_t run_end = i;
+		while(run_end < screen.size() && screen[run_end] != previous[run_end]) {
+			++run_end;
+		}
+		put_varint(runs, unsigned(i - last_end));
+		put_varint(runs, unsigned(run_end - i));
+		for(size_t j = i; j < run_end; ++j) {
+			put_glyph(runs, screen[j]);
+		}
+		++run_count;
+		last_end = i = run_end;
+	}
+	if(run_count == 0) {
+		return false;
+	}
+	put_varint(payload, run_count);
+	payload += runs;
+	return true;
+}
+
+void Recorder::record(const std::vector<Glyph> & screen)
+{
+	if(!out || screen.size() != size_t(width) * height) {
+		return;
+	}
+	int kind = FRAME_DIFF;
+	if(frames_since_keyframe >= KEYFRAME_INTERVAL || previous.size() != screen.size()) {
+		kind = FRAME_KEY;
+	} else if(!encode_diff(screen)) {
+		return;
+	}
+	if(kind == FRAME_KEY) {
+		encode_keyframe(screen);
+		frames_since_keyframe = 0;
+	} else {
+		++frames_since_keyframe;
+	}
+	previous = screen;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_time).count();
+	last_time = now;
+
+	frame.clear();
+	frame += char(kind);
+	put_varint(frame, unsigned(elapsed));
+	put_varint(frame, unsigned(payload.size()));
+	frame += payload;
+	out.write(frame.data(), std::streamsize(frame.size()));
+	if(now - last_flush >= std::chrono::milliseconds(FLUSH_INTERVAL)) {
+		out.flush();
+		last_flush = now;
+	}
+}
+
+
+RecordingBackend::RecordingBackend(Backend & target_backend, Recorder & frame_recorder)
+	: target(target_backend), recorder(frame_recorder), dirty(false)
+{
+}
+
+void RecordingBackend::init()
+{
+	target.init();
+	recorder.start(target.width(), target.height());
+}
+
+unsigned RecordingBackend::width() const
+{
+	return target.width();
+}
+
+unsigned RecordingBackend::height() const
+{
+	return target.height();
+}
+
+void RecordingBackend::put_glyph(int x, int y, const Glyph & glyph)
+{
+	target.put_glyph(x, y, glyph);
+	dirty = true;
+}
+
+void RecordingBackend::put_text(int x, int y, const std::string & text)
+{
+	target.put_text(x, y, text);
+	dirty = true;
+}
+
+Glyph RecordingBackend::get_glyph(int x, int y) const
+{
+	return target.get_glyph(x, y);
+}
+
+void RecordingBackend::clear()
+{
+	target.clear();
+	dirty = true;
+}
+
+void RecordingBackend::record_if_dirty()
+{
+	if(dirty) {
+		unsigned screen_width = target.width(), screen_height = target.height();
+		screen.resize(size_t(screen_width) * screen_height);
+		for(unsigned y = 0; y < screen_height; ++y) {
+			for(unsigned x = 0; x < screen_width; ++x) {
+				screen[x + y * screen_width] = target.get_glyph(int(x), int(y));
+			}
+		}
+		recorder.record(screen);
+		dirty = false;
+	}
+}
+
+void RecordingBackend::refresh()
+{
+	target.refresh();
+	record_if_dirty();
+}
+
+void RecordingBackend::show_cursor(bool visible)
+{
+	target.show_cursor(visible);
+}
+
+void RecordingBackend::move_cursor(int x, int y)
+{
+	target.move_cursor(x, y);
+}
+
+int RecordingBackend::get_key(int timeout)
+{
+	record_if_dirty();
+	return target.get_key(timeout);
+}
+
+
+struct RecordedFrame {
+	int kind;
+	unsigned delay_ms;
+	size_t offset, size;
+};
+
+static bool apply_frame(const std::string & data, const RecordedFrame & frame, std::vector<Glyph> & screen)
+{
+	size_t pos = frame.offset;
+	size_t end = frame.offset + frame.size;
+	unsigned count = 0, skip = 0;
+	Glyph glyph;
+	if(frame.kind == FRAME_KEY) {
+		size_t cell = 0;
+		while(pos < end) {
+			if(!get_varint(data, pos, count) || !get_glyph(data, pos, glyph) || cell + count > screen.size()) {
+				return false;
+			}
+			for(unsigned i = 0; i < count; ++i) {
+				screen[cell++] = glyph;
+			}
+		}
+		return true;
+	}
+	unsigned runs = 0;
+	if(!get_varint(data, pos, runs)) {
+		return false;
+	}
+	size_t cell = 0;
+	while(runs --> 0) {
+		if(!get_varint(data, pos, skip) || !get_varint(data, pos, count) || cell + skip + count > screen.size()) {
+			return false;
+		}
+		cell += skip;
+		for(unsigned i = 0; i < count; ++i) {
+			if(!get_glyph(data, pos, screen[cell++])) {
+				return false;
+			}
+		}
+	}
+	return pos == end;
+}
+
+static void show_frame(Backend & backend, const std::vector<Glyph> & screen, unsigned width)
+{
+	backend.clear();
+	for(size_t i = 0; i < screen.size(); ++i) {
+		backend.put_glyph(int(i % width), int(i / width), screen[i]);
+	}
+	backend.refresh();
+}
+
+int play_recording(Backend & backend, const std::string & filename)
+{
+	std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	unsigned width = 0, height = 0;
+	size_t pos = 5;
+	if(data.compare(0, 4, RECORDING_MAGIC) != 0 || data.size() < 5 || data[4] != char(RECORDING_VERSION)
+			|| !get_varint(data, pos, width) || !get_varint(data, pos, height)) {
+		log("'{0}' is not a valid recording.", filename);
+		return 1;
+	}
+
+	std::vector<RecordedFrame> frames;
+	std::vector<size_t> keyframes;
+	while(pos < data.size()) {
+		RecordedFrame frame;
+		frame.kind = data[pos++];
+		unsigned size = 0;
+		if(!get_varint(data, pos, frame.delay_ms) || !get_varint(data, pos, size) || pos + size > data.size()) {
+			log("Recording '{0}' is truncated.", filename);
+			break;
+		}
+		frame.offset = pos;
+		frame.size = size;
+		pos += size;
+		if(frame.kind == FRAME_KEY) {
+			keyframes.push_back(frames.size());
+		}
+		frames.push_back(frame);
+	}
+	if(keyframes.empty()) {
+		return 0;
+	}
+
+	std::vector<Glyph> screen(size_t(width) * height);
+	size_t current = keyframes.front();
+	bool paused = false;
+	while(current < frames.size()) {
+		if(!apply_frame(data, frames[current], screen)) {
+			log("Recording '{0}' is corrupted at frame {1}.", filename, current);
+			break;
+		}
+		show_frame(backend, screen, width);
+
+		size_t next = current + 1;
+		unsigned waited = 0;
+		unsigned delay = (next < frames.size()) ? std::min(frames[next].delay_ms, unsigned(MAX_PLAYBACK_DELAY)) : 0;
+		while(paused || waited < delay) {
+			int ch = backend.get_key(PLAYBACK_TICK);
+			if(ch == 'q' || ch == Backend::KEY_ESCAPE) {
+				return 0;
+			} else if(ch == ' ') {
+				paused = !paused;
+			} else if(ch == '>' || ch == '<') {
+				size_t keyframe = 0;
+				while(keyframe + 1 < keyframes.size() && keyframes[keyframe + 1] <= current) {
+					++keyframe;
+				}
+				if(ch == '>' && keyframe + 1 < keyframes.size()) {
+					next = keyframes[keyframe + 1];
+				} else if(ch == '<') {
+					next = keyframes[(keyframe > 0 && keyframes[keyframe] == current) ? keyframe - 1 : keyframe];
+				}
+				break;
+			}
+			waited += PLAYBACK_TICK;
+		}
+		current = next;
+	}
+	return 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "backend.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+
+// Session recording: a stream of timestamped frames, where every frame
+// stores only runs of cells changed since the previous one.
+// Full keyframes are written periodically so playback can seek.
+// Output is flushed at most once per FLUSH_INTERVAL ms and on destruction.
+class Recorder {
+public:
+	enum { KEYFRAME_INTERVAL = 100, FLUSH_INTERVAL = 1000 };
+	Recorder(const std::string & filename);
+	// Writes header; frames are recorded only after it.
+	void start(unsigned screen_width, unsigned screen_height);
+	bool is_open() const { return bool(out); }
+	void record(const std::vector<Glyph> & screen);
+private:
+	std::ofstream out;
+	unsigned width, height;
+	std::vector<Glyph> previous;
+	std::string payload, frame;
+	unsigned frames_since_keyframe;
+	std::chrono::steady_clock::time_point last_time, last_flush;
+	void encode_keyframe(const std::vector<Glyph> & screen);
+	bool encode_diff(const std::vector<Glyph> & screen);
+};
+
+// Passes everything to the target backend and records each shown frame.
+// Frame is read back from the target, nothing is drawn twice.
+class RecordingBackend : public Backend {
+public:
+	RecordingBackend(Backend & target_backend, Recorder & frame_recorder);
+	virtual ~RecordingBackend() {}
+	virtual void init();
+	virtual unsigned width() const;
+	virtual unsigned height() const;
+	virtual void put_glyph(int x, int y, const Glyph & glyph);
+	virtual void put_text(int x, int y, const std::string & text);
+	virtual Glyph get_glyph(int x, int y) const;
+	virtual void clear();
+	virtual void refresh();
+	virtual void show_cursor(bool visible);
+	virtual void move_cursor(int x, int y);
+	virtual int get_key(int timeout = WAIT_FOREVER);
+private:
+	Backend & target;
+	Recorder & recorder;
+	std::vector<Glyph> screen;
+	bool dirty;
+	void record_if_dirty();
+};
+
+int play_recording(Backend & backend, const std::string & filename);
@@ -0,0 +1,59 @@
+#include "rng.h"
+
+static uint64_t splitmix64(uint64_t & x)
+{
+	uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static uint32_t rotl(uint32_t x, int k)
+{
+	return (x << k) | (x >> (32 - k));
+}
+
+static void fill_state(uint32_t state[4], uint64_t x)
+{
+	uint64_t a = splitmix64(x), b = splitmix64(x);
+	state[0] = uint32_t(a);
+	state[1] = uint32_t(a >> 32);
+	state[2] = uint32_t(b);
+	state[3] = uint32_t(b >> 32);
+}
+
+Rng::Rng(unsigned seed)
+{
+	fill_state(state, seed);
+}
+
+Rng Rng::stream(unsigned seed, unsigned stream_id, unsigned index)
+{
+	uint64_t x = (uint64_t(stream_id) << 32) ^ index;
+	Rng result;
+	fill_state(result.state, splitmix64(x) ^ seed);
+	return result;
+}
+
+uint32_t Rng::next()
+{
+	uint32_t result = rotl(state[1] * 5, 7) * 9;
+	uint32_t t = state[1] << 9;
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotl(state[3], 11);
+	return result;
+}
+
+unsigned Rng::range(unsigned n)
+{
+	return unsigned((uint64_t(next()) * n) >> 32);
+}
+
+int Rng::range(int min, int max)
+{
+	return min + int(range(unsigned(max - min + 1)));
+}
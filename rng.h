@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+
+// Small and fast xoshiro128** generator owned by a game.
+// Independent streams (per level, per subsystem) are derived from a seed
+// and a stream id, so each one is reproducible regardless of the others.
+class Rng {
+public:
+	uint32_t state[4];
+
+	Rng(unsigned seed = 0);
+	static Rng stream(unsigned seed, unsigned stream_id, unsigned index = 0);
+	uint32_t next();
+	// Returns value in range [0, n).
+	unsigned range(unsigned n);
+	// Returns value in range [min, max].
+	int range(int min, int max);
+};
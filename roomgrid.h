@@ -0,0 +1,25 @@
+#pragma once
+#include <algorithm>
+
+// Level layout: map is split into a grid of cells, and rooms take some of them.
+// Zero room count means a room in every cell.
+struct RoomGrid {
+	// Bounds keep map size (and cell count products) far from overflow.
+	enum { CELL_WIDTH = 20, CELL_HEIGHT = 7, MIN_ROOMS = 2, MAX_COLUMNS = 64, MAX_ROWS = 64 };
+	unsigned columns, rows, rooms;
+
+	RoomGrid(unsigned grid_columns = 3, unsigned grid_rows = 3, unsigned grid_rooms = 0)
+		: columns(grid_columns), rows(grid_rows), rooms(grid_rooms) {}
+	bool valid() const
+	{
+		return columns > 0 && rows > 0 && columns <= MAX_COLUMNS && rows <= MAX_ROWS
+			&& columns * rows >= MIN_ROOMS;
+	}
+	unsigned map_width() const { return columns * CELL_WIDTH; }
+	unsigned map_height() const { return rows * CELL_HEIGHT + 2; }
+	unsigned room_count() const
+	{
+		unsigned cells = columns * rows;
+		return (rooms == 0) ? cells : std::max(unsigned(MIN_ROOMS), std::min(rooms, cells));
+	}
+};
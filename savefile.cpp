@@ -1,4 +1,6 @@
 #include "savefile.h"
+#include "pager.h"
+#include "generate.h"
 #include <chthon/game.h>
 #include <chthon/level.h>
 #include <chthon/items.h>
@@ -7,14 +9,20 @@
 #include <chthon/cell.h>
 #include <chthon/files.h>
 #include <chthon/types.h>
+#include <chthon/format.h>
+#include <set>
+#include <sstream>
 using namespace Chthon;
 
-enum { SAVEFILE_MAJOR_VERSION = 35, SAVEFILE_MINOR_VERSION = 0 };
+enum { SAVEFILE_MAJOR_VERSION = 41, SAVEFILE_MINOR_VERSION = 0 };
 
-static const TypeRegistry<std::string, Cell> * cell_types = nullptr;
-static const TypeRegistry<std::string, Monster> * monster_types = nullptr;
-static const TypeRegistry<std::string, Object> * object_types = nullptr;
-static const TypeRegistry<std::string, Item> * item_types = nullptr;
+// Registries of the game being loaded; per thread, so sessions may load concurrently.
+static thread_local const TypeRegistry<std::string, Cell> * cell_types = nullptr;
+static thread_local const TypeRegistry<std::string, Monster> * monster_types = nullptr;
+static thread_local const TypeRegistry<std::string, Object> * object_types = nullptr;
+static thread_local const TypeRegistry<std::string, Item> * item_types = nullptr;
+static thread_local const LevelPager * level_pager = nullptr;
+static thread_local const ItemStacks * item_stacks = nullptr;
 static const TypeRegistry<std::string, Cell> * get_registry(const CellType *) { return cell_types; }
 static const TypeRegistry<std::string, Monster> * get_registry(const MonsterType *) { return monster_types; }
 static const TypeRegistry<std::string, Object> * get_registry(const ObjectType *) { return object_types; }
@@ -119,6 +127,65 @@ SAVEFILE_STORE(Item, item)
 	savefile.store(item.key_type);
 }
 
+// Runs of identical stackable items are stored once with a count.
+static void store(Reader & savefile, std::vector<Item> & items, const std::string & name)
+{
+	unsigned stacks = 0;
+	savefile.store(stacks);
+	savefile.newline().check(name + " count");
+	items.clear();
+	while(stacks --> 0) {
+		unsigned count = 0;
+		Item item;
+		savefile.store(count);
+		store(savefile, item);
+		savefile.newline().check(name);
+		if(count == 0) {
+			throw Reader::Exception(format("Empty stack of {0}!", name));
+		}
+		items.insert(items.end(), count, item);
+	}
+}
+
+static std::vector<std::vector<unsigned> > group_items(const std::vector<Item> & items, bool by_cell)
+{
+	if(item_stacks) {
+		return item_stacks->group(items, by_cell);
+	}
+	std::vector<std::vector<unsigned> > stacks;
+	for(unsigned i = 0; i < items.size(); ++i) {
+		stacks.push_back(std::vector<unsigned>(1, i));
+	}
+	return stacks;
+}
+
+static void store_stacks(Writer & savefile, const std::vector<Item> & items, const std::vector<std::vector<unsigned> > & stacks, const std::string & name)
+{
+	savefile.store(unsigned(stacks.size()));
+	savefile.newline().check(name + " count");
+	foreach(const std::vector<unsigned> & stack, stacks) {
+		savefile.store(unsigned(stack.size()));
+		store(savefile, items[stack.front()]);
+		savefile.newline().check(name);
+	}
+}
+
+static void store(Writer & savefile, const std::vector<Item> & items, const std::string & name)
+{
+	store_stacks(savefile, items, group_items(items, false), name);
+}
+
+// Items on the floor are stacked only within the same cell.
+static void store_floor_items(Reader & savefile, std::vector<Item> & items)
+{
+	store(savefile, items, "item");
+}
+
+static void store_floor_items(Writer & savefile, const std::vector<Item> & items)
+{
+	store_stacks(savefile, items, group_items(items, true), "item");
+}
+
 SAVEFILE_STORE(Object, object)
 {
 	store_type(savefile, object.type);
@@ -131,7 +198,15 @@ SAVEFILE_STORE(Object, object)
 	store(savefile, object.items, "object item");
 }
 
-SAVEFILE_STORE(Inventory, inventory)
+static void store(Reader & savefile, Inventory & inventory)
+{
+	savefile.store(inventory.wielded);
+	savefile.store(inventory.worn);
+	savefile.newline();
+	store(savefile, inventory.items, "inventory item");
+}
+
+static void store(Writer & savefile, const Inventory & inventory)
 {
 	savefile.store(inventory.wielded);
 	savefile.store(inventory.worn);
@@ -149,20 +224,169 @@ SAVEFILE_STORE(Monster, monster)
 	store(savefile, monster.inventory);
 }
 
-SAVEFILE_STORE(Level, level)
+template<class Savefile, class LevelType>
+void store_entities(Savefile & savefile, LevelType & level)
 {
-	store(savefile, level.map);
-	savefile.newline();
-
 	store(savefile, level.monsters, "monster");
 	savefile.newline();
 
-	store(savefile, level.items, "item");
+	store_floor_items(savefile, level.items);
 	savefile.newline();
 
 	store(savefile, level.objects, "object");
 }
 
+// Generated walls and floor rarely change, so a level is stored as a delta
+// against the one regenerated from its seed: cell types which differ and
+// run-length encoded seen sprites. Entities are stored in full.
+// Baseline hash guards against a generator which has changed since saving.
+static void load_map_delta(Reader & savefile, Map<Cell> & map, const LevelBaseline & baseline)
+{
+	unsigned hash = 0, width = 0, height = 0;
+	savefile.store(hash).store(width).store(height);
+	savefile.newline().check("map size");
+	if(hash != baseline.hash) {
+		throw Reader::Exception("Level was generated differently when saved!");
+	}
+	if(width != baseline.width || height != baseline.height) {
+		throw Reader::Exception(format("Map size {0}x{1} does not match regenerated level {2}x{3}!", width, height, baseline.width, baseline.height));
+	}
+	for(unsigned y = 0; y < height; ++y) {
+		for(unsigned x = 0; x < width; ++x) {
+			map.cell(int(x), int(y)) = Cell(cell_types->get(baseline.cell_id(x, y)));
+		}
+	}
+
+	unsigned changed = 0;
+	savefile.store(changed).newline().check("changed cells count");
+	while(changed --> 0) {
+		Point pos;
+		store(savefile, pos);
+		if(!map.valid(pos)) {
+			throw Reader::Exception(format("Changed cell ({0}, {1}) is out of map!", pos.x, pos.y));
+		}
+		store_type(savefile, map.cell(pos).type);
+		savefile.newline().check("changed cell");
+	}
+
+	unsigned runs = 0;
+	savefile.store(runs).newline().check("seen sprites count");
+	unsigned index = 0;
+	while(runs --> 0) {
+		unsigned length = 0;
+		int sprite = 0;
+		savefile.store(length).store(sprite);
+		savefile.check("seen sprites");
+		if(length > map.cells.size() - index) {
+			throw Reader::Exception("Seen sprites do not fit the map!");
+		}
+		for(unsigned i = 0; i < length; ++i, ++index) {
+			map.cells[index].seen_sprite = sprite;
+		}
+	}
+	savefile.newline();
+}
+
+static void save_map_delta(Writer & savefile, const Map<Cell> & map, const LevelBaseline & baseline)
+{
+	savefile.store(baseline.hash).store(map.width).store(map.height);
+	savefile.newline().check("map size");
+
+	std::vector<Point> changed;
+	for(int y = 0; y < int(map.height); ++y) {
+		for(int x = 0; x < int(map.width); ++x) {
+			if(map.cell(x, y).type->id != baseline.cell_id(unsigned(x), unsigned(y))) {
+				changed.push_back(Point(x, y));
+			}
+		}
+	}
+	savefile.store(unsigned(changed.size())).newline().check("changed cells count");
+	foreach(const Point & pos, changed) {
+		store(savefile, pos);
+		store_type(savefile, map.cell(pos).type);
+		savefile.newline().check("changed cell");
+	}
+
+	std::vector<std::pair<unsigned, int> > runs;
+	foreach(const Cell & cell, map.cells) {
+		if(runs.empty() || runs.back().second != cell.seen_sprite) {
+			runs.push_back(std::make_pair(0u, cell.seen_sprite));
+		}
+		++runs.back().first;
+	}
+	savefile.store(unsigned(runs.size())).newline().check("seen sprites count");
+	for(unsigned i = 0; i < runs.size(); ++i) {
+		savefile.store(runs[i].first).store(runs[i].second);
+		savefile.check("seen sprites");
+	}
+	savefile.newline();
+}
+
+// Paged out levels were generated in this session, so their baselines are cached.
+static const LevelBaseline & find_baseline(const LinearDungeon & game, int level_index)
+{
+	const LevelBaseline * baseline = game.baseline(level_index);
+	if(!baseline) {
+		throw Reader::Exception(format("Level {0} has no baseline to load delta against!", level_index));
+	}
+	return *baseline;
+}
+
+static const LevelBaseline & find_baseline(LinearDungeon & game, int level_index)
+{
+	return game.regenerate_baseline(level_index);
+}
+
+enum { FULL_LEVEL, LEVEL_DELTA, PAGED_LEVEL };
+
+template<class GameType>
+void store_level(Reader & savefile, GameType & game, int level_index, Level & level)
+{
+	unsigned mode = FULL_LEVEL;
+	savefile.store(mode).newline().check("level mode");
+	level = Level();
+	if(mode == PAGED_LEVEL) {
+		std::string data;
+		savefile.store(data).newline().check("paged level");
+		std::istringstream in(data);
+		Reader page(in);
+		store_level(page, game, level_index, level);
+		return;
+	} else if(mode == LEVEL_DELTA) {
+		const LevelBaseline & baseline = find_baseline(game, level_index);
+		level = Level(baseline.width, baseline.height);
+		load_map_delta(savefile, level.map, baseline);
+	} else if(mode == FULL_LEVEL) {
+		store(savefile, level.map);
+	} else {
+		throw Reader::Exception(format("Unknown level mode {0}!", mode));
+	}
+	savefile.newline();
+	store_entities(savefile, level);
+}
+
+// Levels without a cached baseline of the same size are stored in full.
+static void store_level(Writer & savefile, const LinearDungeon & game, int level_index, const Level & level)
+{
+	const LevelBaseline * baseline = game.baseline(level_index);
+	bool regenerable = baseline && baseline->width == level.map.width && baseline->height == level.map.height;
+	savefile.store(unsigned(regenerable ? LEVEL_DELTA : FULL_LEVEL)).newline().check("level mode");
+	if(regenerable) {
+		save_map_delta(savefile, level.map, *baseline);
+	} else {
+		store(savefile, level.map);
+	}
+	savefile.newline();
+	store_entities(savefile, level);
+}
+
+// Paged out level is already a level record, so it goes in verbatim.
+static void store_paged_level(Writer & savefile, const std::string & data)
+{
+	savefile.store(unsigned(PAGED_LEVEL)).newline().check("level mode");
+	savefile.store(data).newline().check("paged level");
+}
+
 template<class Savefile, class K, class V>
 void store(Savefile & savefile, std::map<K, V> & map, const std::string & name)
 {
@@ -187,6 +411,49 @@ void store(Savefile & savefile, const std::map<K, V> & map, const std::string &
 	}
 }
 
+static void store_levels(Reader & savefile, std::map<int, Level> & levels, LinearDungeon & game)
+{
+	unsigned count = 0;
+	savefile.store(count).newline().check("levels count");
+	while(count --> 0) {
+		int level_index = 0;
+		store(savefile, level_index);
+		store_level(savefile, game, level_index, levels[level_index]);
+		savefile.newline().check("levels");
+	}
+}
+
+static void store_levels(Writer & savefile, const std::map<int, Level> & levels, const LinearDungeon & game)
+{
+	std::vector<int> paged;
+	if(level_pager) {
+		paged = level_pager->paged_levels();
+	}
+	savefile.store(unsigned(levels.size() + paged.size())).newline().check("levels count");
+	std::map<int, Level>::const_iterator i;
+	for(i = levels.begin(); i != levels.end(); ++i) {
+		store(savefile, i->first);
+		store_level(savefile, game, i->first, i->second);
+		savefile.newline().check("levels");
+	}
+	foreach(int level_index, paged) {
+		std::string data;
+		if(!level_pager->read_page(level_index, data)) {
+			throw Writer::Exception(format("Cannot read paged level {0}!", level_index));
+		}
+		store(savefile, level_index);
+		store_paged_level(savefile, data);
+		savefile.newline().check("levels");
+	}
+}
+
+SAVEFILE_STORE(Rng, rng)
+{
+	for(unsigned i = 0; i < 4; ++i) {
+		savefile.store(rng.state[i]);
+	}
+}
+
 SAVEFILE_STORE(Game, game)
 {
 	savefile.version(SAVEFILE_MAJOR_VERSION, SAVEFILE_MINOR_VERSION);
@@ -195,21 +462,75 @@ SAVEFILE_STORE(Game, game)
 	savefile.store(game.current_level_index);
 	savefile.store(game.turns);
 	savefile.newline();
-
-	store(savefile, game.levels, "levels");
-	savefile.newline();
 }
 
-void load(Reader & savefile, Game & game)
+static void use_registries(const LinearDungeon & game)
 {
+	item_stacks = &game.stacks;
 	cell_types = &game.cell_types;
 	monster_types = &game.monster_types;
 	object_types = &game.object_types;
 	item_types = &game.item_types;
-	store(savefile, game);
 }
 
-void save(Writer & savefile, const Game & game)
+static void store(Reader & savefile, RoomGrid & grid)
+{
+	savefile.store(grid.columns).store(grid.rows).store(grid.rooms);
+	if(!grid.valid()) {
+		throw Reader::Exception(format("Invalid room grid {0}x{1}!", grid.columns, grid.rows));
+	}
+}
+
+static void store(Writer & savefile, const RoomGrid & grid)
+{
+	savefile.store(grid.columns).store(grid.rows).store(grid.rooms);
+}
+
+template<class Savefile, class GameType, class Dungeon>
+void store_dungeon(Savefile & savefile, GameType & base, Dungeon & game)
+{
+	store(savefile, base);
+	savefile.store(game.seed);
+	store(savefile, game.ai_random);
+	savefile.newline().check("random state");
+	store(savefile, game.grid);
+	savefile.newline().check("room grid");
+
+	// Levels go after the seed, as they are regenerated from it.
+	store_levels(savefile, game.levels, game);
+	savefile.newline();
+}
+
+void load(Reader & savefile, LinearDungeon & game)
+{
+	use_registries(game);
+	game.forget_baselines();
+	Game & base = game;
+	store_dungeon(savefile, base, game);
+}
+
+void save(Writer & savefile, const LinearDungeon & game)
+{
+	use_registries(game);
+	level_pager = &game.pager;
+	try {
+		const Game & base = game;
+		store_dungeon(savefile, base, game);
+	} catch(...) {
+		level_pager = nullptr;
+		throw;
+	}
+	level_pager = nullptr;
+}
+
+void load_level(Reader & savefile, const LinearDungeon & game, int level_index, Level & level)
+{
+	use_registries(game);
+	store_level(savefile, game, level_index, level);
+}
+
+void save_level(Writer & savefile, const LinearDungeon & game, int level_index, const Level & level)
 {
-	store(savefile, game);
+	use_registries(game);
+	store_level(savefile, game, level_index, level);
 }
@@ -2,9 +2,13 @@
 namespace Chthon {
 	class Reader;
 	class Writer;
-	class Game;
+	class Level;
 }
+class LevelPager;
+class LinearDungeon;
 
-void load(Chthon::Reader & reader, Chthon::Game & game);
-void save(Chthon::Writer & reader, const Chthon::Game & game);
+void load(Chthon::Reader & reader, LinearDungeon & game);
+void save(Chthon::Writer & reader, const LinearDungeon & game);
+void load_level(Chthon::Reader & reader, const LinearDungeon & game, int level_index, Chthon::Level & level);
+void save_level(Chthon::Writer & writer, const LinearDungeon & game, int level_index, const Chthon::Level & level);
 
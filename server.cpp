@@ -0,0 +1,270 @@
+#include "server.h"
+#include "session.h"
+#include "backend.h"
+#include "logbuffer.h"
+#include "players.h"
+#include <chthon/log.h>
+#include <chthon/util.h>
+#include <fstream>
+#include <deque>
+#include <set>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <pthread.h>
+#include <csignal>
+#include <cstring>
+#include <cctype>
+#include <ctime>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+using namespace Chthon;
+
+enum {
+	SESSION_STACK_SIZE = 512 * 1024,
+	MAX_NAME_LENGTH = 16,
+	WORKER_COUNT = 16
+};
+
+struct Session {
+	int fd;
+	unsigned id;
+};
+
+static PlayerTable players;
+
+static std::string ask_name(Backend & backend)
+{
+	std::string name;
+	while(true) {
+		backend.clear();
+		backend.put_text(0, 0, "Welcome to the Temple of Trials.");
+		backend.put_text(0, 2, "Your name: " + name);
+		backend.refresh();
+		int ch = backend.get_key();
+		if(ch == '\r' || ch == '\n') {
+			if(!name.empty()) {
+				return name;
+			}
+		} else if(ch == 127 || ch == 8) {
+			if(!name.empty()) {
+				name.erase(name.size() - 1);
+			}
+		} else if(ch == 3 || ch == 4) {
+			throw Backend::Hangup();
+		} else if(name.size() < MAX_NAME_LENGTH && (isalnum(ch) || ch == '_' || ch == '-')) {
+			name += char(ch);
+		}
+	}
+}
+
+static void run_session(const Session & session)
+{
+	PlayerTable::Handle player;
+	try {
+		AnsiBackend backend(session.fd, session.fd);
+		std::string name = ask_name(backend);
+		player = players.enter(name, session.id);
+		if(player.null()) {
+			backend.clear();
+			backend.put_text(0, 0, "This player is already in the Temple.");
+			backend.refresh();
+			return;
+		}
+		std::ofstream session_log(("temple-" + name + ".log").c_str(), std::ios::app);
+		LogRedirect redirect(session_log);
+		log("Session #{0} started.", session.id);
+		std::string recording_name = "temple-" + name + "-" + std::to_string(time(nullptr)) + ".rec";
+		SessionOptions options("temple-" + name + ".sav", unsigned(time(nullptr)) ^ (session.id * 2654435761u));
+		options.recording_name = recording_name;
+		options.started = std::chrono::steady_clock::now();
+		int result = play(backend, options);
+		log("Session #{0} finished with code {1}.", session.id, result);
+	} catch(const Backend::Hangup &) {
+		log("Session #{0}: connection closed.", session.id);
+	}
+	if(!player.null()) {
+		unsigned left = players.leave(player);
+		log("Session #{0} left, {1} players remain.", session.id, left);
+	}
+}
+
+// Fixed set of session workers fed from a queue of accepted connections.
+// Connections beyond the pool size wait for a free worker.
+class SessionPool {
+public:
+	SessionPool() : stopping(false), idle(0) {}
+	void start(unsigned count);
+	void submit(const Session & session);
+	// Disconnects active and waiting sessions (they save and exit) and joins workers.
+	void stop();
+private:
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::deque<Session> pending;
+	std::set<int> active_fds;
+	std::vector<pthread_t> workers;
+	bool stopping;
+	unsigned idle;
+
+	static void * worker_thread(void * data);
+	void work();
+};
+
+void SessionPool::start(unsigned count)
+{
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, SESSION_STACK_SIZE);
+	for(unsigned i = 0; i < count; ++i) {
+		pthread_t thread;
+		if(pthread_create(&thread, &attr, worker_thread, this) == 0) {
+			workers.push_back(thread);
+		}
+	}
+	pthread_attr_destroy(&attr);
+	log("Started {0} session workers.", workers.size());
+}
+
+void SessionPool::submit(const Session & session)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if(idle == 0) {
+		static const char BUSY[] = "The Temple is full, please wait...\r\n";
+		ssize_t written = write(session.fd, BUSY, sizeof(BUSY) - 1);
+		(void)written;
+	}
+	pending.push_back(session);
+	wakeup.notify_one();
+}
+
+void SessionPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		foreach(const Session & session, pending) {
+			close(session.fd);
+		}
+		pending.clear();
+		foreach(int fd, active_fds) {
+			shutdown(fd, SHUT_RDWR);
+		}
+		wakeup.notify_all();
+	}
+	foreach(pthread_t thread, workers) {
+		pthread_join(thread, nullptr);
+	}
+	workers.clear();
+}
+
+void * SessionPool::worker_thread(void * data)
+{
+	static_cast<SessionPool*>(data)->work();
+	return nullptr;
+}
+
+void SessionPool::work()
+{
+	while(true) {
+		Session session;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			++idle;
+			while(!stopping && pending.empty()) {
+				wakeup.wait(lock);
+			}
+			--idle;
+			if(stopping) {
+				return;
+			}
+			session = pending.front();
+			pending.pop_front();
+			active_fds.insert(session.fd);
+		}
+		log("Session #{0} connected.", session.id);
+		run_session(session);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			active_fds.erase(session.fd);
+			close(session.fd);
+		}
+		log("Session #{0} disconnected.", session.id);
+	}
+}
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int)
+{
+	stop_requested = 1;
+}
+
+int run_server(int port, std::ostream & log_stream)
+{
+	direct_synchronized_log(log_stream);
+
+	signal(SIGPIPE, SIG_IGN);
+	// No SA_RESTART, so that signal interrupts accept().
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = request_stop;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	if(listener < 0) {
+		log("Cannot create socket: {0}", strerror(errno));
+		return 1;
+	}
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(uint16_t(port));
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if(bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+		log("Cannot listen on port {0}: {1}", port, strerror(errno));
+		close(listener);
+		return 1;
+	}
+	log("Server is listening on port {0}.", port);
+
+	// Stop signals are handled by this thread only, workers block them.
+	sigset_t stop_signals, previous_mask;
+	sigemptyset(&stop_signals);
+	sigaddset(&stop_signals, SIGINT);
+	sigaddset(&stop_signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &stop_signals, &previous_mask);
+	SessionPool pool;
+	pool.start(WORKER_COUNT);
+	pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+
+	int result = 0;
+	unsigned last_id = 0;
+	while(!stop_requested) {
+		int fd = accept(listener, nullptr, nullptr);
+		if(fd < 0) {
+			if(errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			log("Cannot accept connection: {0}", strerror(errno));
+			result = 1;
+			break;
+		}
+		Session session;
+		session.fd = fd;
+		session.id = ++last_id;
+		pool.submit(session);
+	}
+	log("Server is shutting down.");
+	close(listener);
+	pool.stop();
+	return result;
+}
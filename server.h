@@ -0,0 +1,11 @@
+#pragma once
+#include <iosfwd>
+
+enum { DEFAULT_SERVER_PORT = 2727 };
+
+// Serves games over local TCP, one session per connection, with a fixed
+// number of sessions running at once. SIGINT or SIGTERM stops the server:
+// games in progress are suspended and saved.
+// Each player's game log goes to its own temple-NAME.log.
+// Clients are expected to send raw keypresses, e.g. `stty raw -echo; nc localhost 2727`.
+int run_server(int port, std::ostream & log_stream);
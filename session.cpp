@@ -0,0 +1,190 @@
+#include "session.h"
+#include "generate.h"
+#include "player.h"
+#include "console.h"
+#include "backend.h"
+#include "savefile.h"
+#include "recording.h"
+#include "memory.h"
+#include "logbuffer.h"
+#include <chthon/game.h>
+#include <chthon/files.h>
+#include <chthon/log.h>
+#include <chthon/format.h>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <thread>
+using namespace Chthon;
+
+enum { AUTOSAVE_TURNS = 20, AUTOSAVE_SECONDS = 30 };
+
+static std::string autosave_name(const std::string & savefile_name)
+{
+	return savefile_name + ".auto";
+}
+
+bool load_game(LinearDungeon & game, const std::string & original_savefile_name)
+{
+	std::string savefile_name = original_savefile_name;
+	if(!file_exists(savefile_name)) {
+		savefile_name = autosave_name(original_savefile_name);
+		if(!file_exists(savefile_name)) {
+			game.create_new_game();
+			return true;
+		}
+		log("Recovering game from autosave '{0}'.", savefile_name);
+	}
+	try {
+		std::ifstream in(savefile_name.c_str(), std::ios::in);
+		if(!in) {
+			throw Reader::Exception(format("Cannot open file '{0}' for reading!", savefile_name));
+		}
+		Reader savefile(in);
+		load(savefile, game);
+		if(remove(savefile_name.c_str()) != 0) {
+			throw Reader::Exception("Error: cannot delete savefile!");
+		}
+	} catch(const Reader::Exception & e) {
+		log(e.message);
+		return false;
+	}
+	return true;
+}
+
+bool save_game(const LinearDungeon & game, const std::string & savefile_name)
+{
+	try {
+		std::ofstream out(savefile_name.c_str(), std::ios::out);
+		if(!out) {
+			throw Writer::Exception(format("Cannot open file '{0}' for writing!", savefile_name));
+		}
+		Writer savefile(out);
+		save(savefile, game);
+		out.flush();
+		if(!out) {
+			throw Writer::Exception(format("Cannot write file '{0}'!", savefile_name));
+		}
+	} catch(const Writer::Exception & e) {
+		log(e.message);
+		return false;
+	}
+	return true;
+}
+
+int play(Backend & backend, const SessionOptions & options)
+{
+	if(!options.recording_name.empty()) {
+		Recorder recorder(options.recording_name);
+		RecordingBackend recording_backend(backend, recorder);
+		SessionOptions unrecorded_options = options;
+		unrecorded_options.recording_name.clear();
+		return play(recording_backend, unrecorded_options);
+	}
+	const std::string & savefile_name = options.savefile_name;
+	TempleUI console(backend);
+	console.log_messages = options.log_messages;
+	// Player controller is owned by the game once it is built.
+	std::unique_ptr<PlayerControl> player_control(new PlayerControl(console));
+	PlayerControl * player = player_control.get();
+
+	// Game is built and savefile is parsed while terminal is being set up.
+	// Whatever loader throws is rethrown here, once both are done.
+	// Loader logs to the same sink as the session.
+	std::unique_ptr<LinearDungeon> dungeon;
+	bool is_loaded = false;
+	std::exception_ptr load_error;
+	std::streambuf * log_sink = LogRedirect::current_sink();
+	std::thread loader([&]() {
+		LogRedirect redirect(log_sink);
+		try {
+			dungeon.reset(new LinearDungeon(player));
+			player_control.release();
+			dungeon->pager.configure(savefile_name + ".pages", options.level_memory_budget);
+			dungeon->set_seed(options.seed);
+			dungeon->grid = options.grid;
+			is_loaded = load_game(*dungeon, savefile_name);
+		} catch(...) {
+			load_error = std::current_exception();
+		}
+	});
+	try {
+		backend.init();
+	} catch(...) {
+		loader.join();
+		throw;
+	}
+	loader.join();
+	if(load_error) {
+		std::rethrow_exception(load_error);
+	}
+	if(!is_loaded) {
+		return 1;
+	}
+	LinearDungeon & game = *dungeon;
+	player->pager = &game.pager;
+	player->planner = &game.travel_planner;
+	player->stacks = &game.stacks;
+	player->travel_opens_doors = options.travel_opens_doors;
+	console.stacks = &game.stacks;
+
+	console.draw_game(game);
+	int first_frame = int(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - options.started).count());
+	log("Time to first frame: {0} ms.", first_frame);
+
+	// Levels are paged out only between player's turns, when nothing refers to them.
+	console.event_loop.add_idle_task([&]() {
+		game.pager.enforce_budget(game);
+		return false;
+	});
+
+	// Autosave is encoded while player thinks and is used only to recover after a crash,
+	// so it is written only every few turns or seconds of play.
+	int autosaved_turn = game.turns;
+	std::chrono::steady_clock::time_point autosaved_at = std::chrono::steady_clock::now();
+	console.event_loop.add_idle_task([&]() {
+		if(game.state != Game::PLAYING || game.turns == autosaved_turn) {
+			return false;
+		}
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if(game.turns - autosaved_turn < AUTOSAVE_TURNS && now - autosaved_at < std::chrono::seconds(AUTOSAVE_SECONDS)) {
+			return false;
+		}
+		autosaved_turn = game.turns;
+		autosaved_at = now;
+		std::string temp_name = autosave_name(savefile_name) + ".tmp";
+		bool saved = save_game(game, temp_name);
+		if(saved && rename(temp_name.c_str(), autosave_name(savefile_name).c_str()) != 0) {
+			log("Cannot replace autosave '{0}': {1}", autosave_name(savefile_name), strerror(errno));
+			saved = false;
+		}
+		if(!saved) {
+			remove(temp_name.c_str());
+			console.message("Autosave failed.");
+		}
+		return false;
+	});
+
+	try {
+		game.run();
+		console.see_messages(game);
+	} catch(const Backend::Hangup &) {
+		log("Input is closed, suspending game.");
+		game.state = Game::SUSPENDED;
+	}
+	MemoryReport report;
+	player->report_memory(report, game);
+	foreach(const std::string & line, report.lines()) {
+		log("Memory: " + line);
+	}
+
+	// Autosave is kept if the game could not be saved properly.
+	if(game.state == Game::SUSPENDED && !save_game(game, savefile_name)) {
+		return 1;
+	}
+	remove(autosave_name(savefile_name).c_str());
+	return 0;
+}
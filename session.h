@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <chrono>
+#include "roomgrid.h"
+class Backend;
+class LinearDungeon;
+
+struct SessionOptions {
+	enum { DEFAULT_LEVEL_MEMORY_BUDGET = 512 * 1024 };
+	std::string savefile_name;
+	// Non-empty name records what player sees.
+	std::string recording_name;
+	bool log_messages;
+	// Travel opens closed doors on its way instead of stopping at them.
+	bool travel_opens_doors;
+	// Visited levels above this size are paged out to disk.
+	size_t level_memory_budget;
+	// Seed and layout for a new game; loaded game keeps its own.
+	unsigned seed;
+	RoomGrid grid;
+	// Time to first frame is measured from here: process start for a local
+	// game, the moment player is let in for a server session.
+	std::chrono::steady_clock::time_point started;
+
+	SessionOptions(const std::string & session_savefile_name, unsigned session_seed)
+		: savefile_name(session_savefile_name), log_messages(false), travel_opens_doors(false),
+		level_memory_budget(DEFAULT_LEVEL_MEMORY_BUDGET), seed(session_seed),
+		started(std::chrono::steady_clock::now()) {}
+};
+
+bool load_game(LinearDungeon & game, const std::string & savefile_name);
+bool save_game(const LinearDungeon & game, const std::string & savefile_name);
+int play(Backend & backend, const SessionOptions & options);
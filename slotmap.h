@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+
+// Dense storage addressed by generational handles.
+// Values are contiguous, so iteration is a plain vector walk. Removal moves
+// the last value into the hole, so insert and remove are both O(1).
+// Handles stay valid while their value lives; handle of a removed value
+// is recognized by its stale generation and never reaches a new value.
+template<class T>
+class SlotMap {
+public:
+	struct Handle {
+		unsigned index, generation;
+		Handle() : index(0), generation(0) {}
+		Handle(unsigned handle_index, unsigned handle_generation)
+			: index(handle_index), generation(handle_generation) {}
+		bool null() const { return generation == 0; }
+		bool operator==(const Handle & other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const Handle & other) const { return !(*this == other); }
+	};
+	typedef typename std::vector<T>::iterator iterator;
+	typedef typename std::vector<T>::const_iterator const_iterator;
+
+	Handle insert(const T & value)
+	{
+		unsigned index;
+		if(free_slots.empty()) {
+			index = unsigned(slots.size());
+			slots.push_back(Slot());
+		} else {
+			index = free_slots.back();
+			free_slots.pop_back();
+		}
+		slots[index].dense = unsigned(values.size());
+		values.push_back(value);
+		owners.push_back(index);
+		return Handle(index, slots[index].generation);
+	}
+
+	bool remove(const Handle & handle)
+	{
+		if(!contains(handle)) {
+			return false;
+		}
+		Slot & slot = slots[handle.index];
+		unsigned last = unsigned(values.size() - 1);
+		if(slot.dense != last) {
+			values[slot.dense] = values[last];
+			owners[slot.dense] = owners[last];
+			slots[owners[slot.dense]].dense = slot.dense;
+		}
+		values.pop_back();
+		owners.pop_back();
+		slot.dense = FREE;
+		if(++slot.generation == 0) {
+			slot.generation = 1;
+		}
+		free_slots.push_back(handle.index);
+		return true;
+	}
+
+	bool contains(const Handle & handle) const
+	{
+		return handle.index < slots.size()
+			&& slots[handle.index].dense != FREE
+			&& slots[handle.index].generation == handle.generation;
+	}
+
+	T * get(const Handle & handle)
+	{
+		return contains(handle) ? &values[slots[handle.index].dense] : nullptr;
+	}
+	const T * get(const Handle & handle) const
+	{
+		return contains(handle) ? &values[slots[handle.index].dense] : nullptr;
+	}
+
+	// Handle of value at given position of dense storage.
+	Handle handle_at(unsigned dense_index) const
+	{
+		unsigned index = owners[dense_index];
+		return Handle(index, slots[index].generation);
+	}
+
+	unsigned size() const { return unsigned(values.size()); }
+	bool empty() const { return values.empty(); }
+	iterator begin() { return values.begin(); }
+	iterator end() { return values.end(); }
+	const_iterator begin() const { return values.begin(); }
+	const_iterator end() const { return values.end(); }
+private:
+	static const unsigned FREE = ~0u;
+	struct Slot {
+		unsigned dense, generation;
+		Slot() : dense(FREE), generation(1) {}
+	};
+	std::vector<Slot> slots;
+	std::vector<unsigned> free_slots;
+	std::vector<T> values;
+	std::vector<unsigned> owners;
+};
@@ -0,0 +1,51 @@
+#include "stacks.h"
+#include <chthon/items.h>
+using namespace Chthon;
+
+bool ItemStacks::is_stackable(const Item & item) const
+{
+	return item.valid() && stackable_types.count(item.type->id) > 0;
+}
+
+bool ItemStacks::same_kind(const Item & a, const Item & b)
+{
+	return a.type->id == b.type->id
+		&& a.full_type->id == b.full_type->id && a.empty_type->id == b.empty_type->id
+		&& a.key_type == b.key_type;
+}
+
+std::vector<unsigned> ItemStacks::stack_slots(const Inventory & inventory, unsigned slot) const
+{
+	std::vector<unsigned> slots;
+	const Item & item = inventory.get_item(slot);
+	if(!item.valid()) {
+		return slots;
+	}
+	slots.push_back(slot);
+	if(!is_stackable(item)) {
+		return slots;
+	}
+	for(unsigned other = 0; other < inventory.items.size(); ++other) {
+		if(other != slot && inventory.items[other].valid() && same_kind(inventory.items[other], item)) {
+			slots.push_back(other);
+		}
+	}
+	return slots;
+}
+
+std::vector<std::vector<unsigned> > ItemStacks::group(const std::vector<Item> & items, bool by_cell) const
+{
+	std::vector<std::vector<unsigned> > stacks;
+	for(unsigned i = 0; i < items.size(); ++i) {
+		const Item & item = items[i];
+		if(!stacks.empty() && is_stackable(item)) {
+			const Item & previous = items[stacks.back().back()];
+			if(is_stackable(previous) && same_kind(previous, item) && (!by_cell || previous.pos == item.pos)) {
+				stacks.back().push_back(i);
+				continue;
+			}
+		}
+		stacks.push_back(std::vector<unsigned>(1, i));
+	}
+	return stacks;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <set>
+#include <string>
+#include <vector>
+namespace Chthon {
+	class Item;
+	class Inventory;
+}
+
+// Chthon keeps every item separately, so identical items of stackable types
+// are shown, grabbed, dropped and stored as one stack with a count.
+class ItemStacks {
+public:
+	std::set<std::string> stackable_types;
+
+	bool is_stackable(const Chthon::Item & item) const;
+	// Same type, contents and key; position is not compared.
+	static bool same_kind(const Chthon::Item & a, const Chthon::Item & b);
+	// Slots of items stacked with the one in given slot, that one first.
+	std::vector<unsigned> stack_slots(const Chthon::Inventory & inventory, unsigned slot) const;
+	// Indices of items grouped into stacks of adjacent identical items,
+	// so item order is kept; floor items are grouped within their cell.
+	std::vector<std::vector<unsigned> > group(const std::vector<Chthon::Item> & items, bool by_cell) const;
+};
@@ -0,0 +1,239 @@
+#include "stress.h"
+#include "generate.h"
+#include <chthon/level.h>
+#include <chthon/log.h>
+#include <chthon/format.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+using namespace Chthon;
+
+enum {
+	GENERATED_LEVEL_KINDS = 4,
+	MAX_REPORTED_FAILURES = 100
+};
+
+static bool is_walkable(const Level & level, const Point & pos, bool through_locked_doors)
+{
+	if(!level.map.valid(pos)) {
+		return false;
+	}
+	const Object & object = find_at(level.objects, pos);
+	if(object.valid()) {
+		if(object.type->openable) {
+			return through_locked_doors || !object.locked;
+		}
+		if(!object.type->passable) {
+			return false;
+		}
+	}
+	return level.map.cell(pos).type->passable;
+}
+
+static std::vector<bool> flood_fill(const Level & level, const Point & start, bool through_locked_doors)
+{
+	std::vector<bool> reached(level.map.width * level.map.height, false);
+	std::vector<Point> queue;
+	queue.push_back(start);
+	reached[unsigned(start.x) + unsigned(start.y) * level.map.width] = true;
+	while(!queue.empty()) {
+		Point current = queue.back();
+		queue.pop_back();
+		for(int dy = -1; dy <= 1; ++dy) {
+			for(int dx = -1; dx <= 1; ++dx) {
+				Point next = current + Point(dx, dy);
+				if(!is_walkable(level, next, through_locked_doors)) {
+					continue;
+				}
+				unsigned index = unsigned(next.x) + unsigned(next.y) * level.map.width;
+				if(!reached[index]) {
+					reached[index] = true;
+					queue.push_back(next);
+				}
+			}
+		}
+	}
+	return reached;
+}
+
+static bool is_reached(const Level & level, const std::vector<bool> & reached, const Point & pos)
+{
+	return level.map.valid(pos) && reached[unsigned(pos.x) + unsigned(pos.y) * level.map.width];
+}
+
+static bool is_near_reached(const Level & level, const std::vector<bool> & reached, const Point & pos)
+{
+	for(int dy = -1; dy <= 1; ++dy) {
+		for(int dx = -1; dx <= 1; ++dx) {
+			if((dx != 0 || dy != 0) && is_reached(level, reached, pos + Point(dx, dy))) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+std::string validate_level(const Level & level)
+{
+	const Monster & player = level.get_player();
+	if(!player.valid()) {
+		return "no player";
+	}
+	std::vector<bool> before_gate = flood_fill(level, player.pos, false);
+	std::vector<bool> after_gate = flood_fill(level, player.pos, true);
+
+	bool has_locked_doors = false;
+	foreach(const Object & object, level.objects) {
+		if(object.locked) {
+			has_locked_doors = true;
+			if(!is_near_reached(level, before_gate, object.pos)) {
+				return format("locked door at ({0}, {1}) is unreachable", object.pos.x, object.pos.y);
+			}
+		}
+		bool is_exit = object.type->id == "stairs_down" || object.type->id == "stairs_up" || object.type->id == "gate";
+		if(is_exit && !is_reached(level, after_gate, object.pos)) {
+			return format("{0} at ({1}, {2}) is unreachable", object.type->id, object.pos.x, object.pos.y);
+		}
+	}
+	foreach(const Item & item, level.items) {
+		if(item.type->quest && !is_reached(level, after_gate, item.pos)) {
+			return format("{0} at ({1}, {2}) is unreachable", item.type->id, item.pos.x, item.pos.y);
+		}
+	}
+	if(has_locked_doors) {
+		bool key_is_reachable = false;
+		foreach(const Monster & monster, level.monsters) {
+			foreach(const Item & item, monster.inventory.items) {
+				if(item.valid() && item.type->id == "key" && is_reached(level, before_gate, monster.pos)) {
+					key_is_reachable = true;
+				}
+			}
+		}
+		foreach(const Item & item, level.items) {
+			if(item.type->id == "key" && is_reached(level, before_gate, item.pos)) {
+				key_is_reachable = true;
+			}
+		}
+		if(!key_is_reachable) {
+			return "key is unreachable or missing";
+		}
+	}
+	return std::string();
+}
+
+static void run_worker(int output_fd, unsigned worker, unsigned workers, unsigned level_count, unsigned first_seed, const RoomGrid & grid)
+{
+	std::ostream null_log(nullptr);
+	direct_log(&null_log);
+
+	LinearDungeon game(nullptr);
+	game.grid = grid;
+	Level level;
+	unsigned generated = 0, failed = 0;
+	std::ostringstream out;
+	for(unsigned i = worker; i < level_count; i += workers) {
+		unsigned seed = first_seed + i;
+		int level_index = 1 + int(seed % GENERATED_LEVEL_KINDS);
+		game.set_seed(seed);
+		game.generate(level, level_index);
+		++generated;
+		std::string problem = validate_level(level);
+		if(!problem.empty()) {
+			++failed;
+			if(failed <= MAX_REPORTED_FAILURES) {
+				out << "F " << seed << ' ' << level_index << ' ' << problem << '\n';
+			}
+		}
+	}
+	out << "D " << generated << ' ' << failed << '\n';
+	std::string result = out.str();
+	size_t written = 0;
+	while(written < result.size()) {
+		ssize_t size = write(output_fd, result.data() + written, result.size() - written);
+		if(size <= 0) {
+			break;
+		}
+		written += size_t(size);
+	}
+}
+
+int run_generator_stress(unsigned level_count, unsigned workers, unsigned first_seed, const RoomGrid & grid)
+{
+	if(workers == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = cpus > 0 ? unsigned(cpus) : 1;
+	}
+	std::cout << "Generating " << level_count << " levels of " << grid.room_count() << " rooms (" << grid.columns << "x" << grid.rows << ")"
+		<< " on " << workers << " workers, seeds from " << first_seed << "..." << std::endl;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Workers are processes, so a level which crashes generator does not take down the whole run.
+	std::vector<int> pipes;
+	std::vector<pid_t> children;
+	for(unsigned worker = 0; worker < workers; ++worker) {
+		int fds[2];
+		if(pipe(fds) != 0) {
+			perror("pipe");
+			return 1;
+		}
+		pid_t pid = fork();
+		if(pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if(pid == 0) {
+			close(fds[0]);
+			run_worker(fds[1], worker, workers, level_count, first_seed, grid);
+			close(fds[1]);
+			_exit(0);
+		}
+		close(fds[1]);
+		pipes.push_back(fds[0]);
+		children.push_back(pid);
+	}
+
+	unsigned generated = 0, failed = 0;
+	std::vector<std::string> failures;
+	for(unsigned i = 0; i < pipes.size(); ++i) {
+		std::string data;
+		char buffer[4096];
+		ssize_t size;
+		while((size = read(pipes[i], buffer, sizeof(buffer))) > 0) {
+			data.append(buffer, size_t(size));
+		}
+		close(pipes[i]);
+		waitpid(children[i], nullptr, 0);
+
+		std::istringstream in(data);
+		std::string line;
+		while(std::getline(in, line)) {
+			if(line.compare(0, 2, "F ") == 0) {
+				failures.push_back(line.substr(2));
+			} else if(line.compare(0, 2, "D ") == 0) {
+				unsigned worker_generated = 0, worker_failed = 0;
+				std::istringstream(line.substr(2)) >> worker_generated >> worker_failed;
+				generated += worker_generated;
+				failed += worker_failed;
+			}
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::string summary = format("Generated {0} levels in {1} s ({2} levels/s), {3} failed.",
+			generated, seconds, seconds > 0 ? double(generated) / seconds : 0.0, failed);
+	std::cout << summary << std::endl;
+	log(summary);
+	foreach(const std::string & failure, failures) {
+		std::cout << "Failed seed " << failure << std::endl;
+		log("Failed seed " + failure);
+	}
+	if(failures.size() < failed) {
+		std::cout << "(" << failed - failures.size() << " more failures not shown)" << std::endl;
+	}
+	return (generated == level_count && failed == 0) ? 0 : 1;
+}
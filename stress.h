@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+#include "roomgrid.h"
+namespace Chthon {
+	class Level;
+}
+
+// Returns empty string if stairs, gate, quest item, key holder and
+// locked doors of the level are reachable from player's position,
+// otherwise a description of the problem.
+std::string validate_level(const Chthon::Level & level);
+
+// Generates level_count levels with consecutive seeds starting from first_seed,
+// spread over worker processes, validates every one of them and reports
+// throughput and failing seeds to stdout.
+int run_generator_stress(unsigned level_count, unsigned workers, unsigned first_seed, const RoomGrid & grid);
@@ -0,0 +1,87 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <sstream>
+#include <unistd.h>
+
+// Tiny unit test framework. Tests live in test/*.cpp:
+//
+//   SUITE(name) {
+//   TEST(should_do_something)
+//   {
+//       ASSERT(condition);
+//       EQUAL(actual, expected);
+//   }
+//   }
+//
+// Every TEST registers itself on startup; test/main.cpp runs them all.
+namespace Test {
+
+struct Failure {
+	std::string message;
+	Failure(const std::string & failure_message) : message(failure_message) {}
+};
+
+typedef void (*Function)();
+
+struct Case {
+	const char * suite;
+	const char * name;
+	Function function;
+};
+
+inline std::vector<Case> & all_cases()
+{
+	static std::vector<Case> cases;
+	return cases;
+}
+
+struct Registrar {
+	Registrar(const char * suite, const char * name, Function function)
+	{
+		Case test_case = { suite, name, function };
+		all_cases().push_back(test_case);
+	}
+};
+
+inline void fail(const std::string & text, const char * file, int line)
+{
+	std::ostringstream out;
+	out << file << ":" << line << ": " << text;
+	throw Failure(out.str());
+}
+
+// Scratch file name of this test run, so that concurrent runs do not collide.
+inline std::string temp_filename(const std::string & name)
+{
+	std::ostringstream out;
+	out << "/tmp/temple_test_" << getpid() << "_" << name;
+	return out.str();
+}
+
+template<class A, class B>
+void equal(const A & actual, const B & expected, const char * actual_text, const char * expected_text, const char * file, int line)
+{
+	if(!(actual == expected)) {
+		std::ostringstream out;
+		out << actual_text << " == " << expected_text << " failed: got <" << actual << ">, expected <" << expected << ">";
+		fail(out.str(), file, line);
+	}
+}
+
+}
+
+#define SUITE(suite) \
+	namespace Suite_##suite { static const char * suite_name() { return #suite; } } \
+	namespace Suite_##suite
+
+#define TEST(test) \
+	static void test_##test(); \
+	static Test::Registrar registrar_##test(suite_name(), #test, test_##test); \
+	static void test_##test()
+
+#define ASSERT(condition) \
+	do { if(!(condition)) { Test::fail("ASSERT(" #condition ") failed", __FILE__, __LINE__); } } while(false)
+
+#define EQUAL(actual, expected) \
+	Test::equal((actual), (expected), #actual, #expected, __FILE__, __LINE__)
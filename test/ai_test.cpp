@@ -0,0 +1,89 @@
+#include "../ai.h"
+#include "../generate.h"
+#include "../rng.h"
+#include "../test.h"
+#include <chthon/level.h>
+#include <chthon/actions.h>
+using namespace Chthon;
+
+namespace {
+
+// Lit room of floor with player at (1, 2) and given monster at (5, 2).
+struct AIFixture {
+	LinearDungeon game;
+	Rng random;
+	AIFixture(const std::string & monster_type)
+		: game(nullptr), random(1)
+	{
+		game.current_level_index = 1;
+		Level & level = game.levels[1];
+		level = Level(9, 5);
+		level.map.fill(Cell(game.cell_types.get("floor")));
+		for(unsigned i = 0; i < level.map.cells.size(); ++i) {
+			level.map.cells[i].visible = true;
+		}
+		game.add_monster(level, "player").pos(Point(1, 2));
+		game.add_monster(level, monster_type).pos(Point(5, 2));
+	}
+	Monster & monster() { return game.current_level().monsters.back(); }
+	void wall_in_monster()
+	{
+		Level & level = game.current_level();
+		for(int y = 1; y <= 3; ++y) {
+			for(int x = 4; x <= 6; ++x) {
+				if(x != 5 || y != 2) {
+					level.map.cell(x, y) = Cell(game.cell_types.get("wall"));
+				}
+			}
+		}
+	}
+	template<class T>
+	bool acts_with(TempleAI & ai)
+	{
+		Action * action = ai.act(monster(), game);
+		bool result = dynamic_cast<T*>(action) != nullptr;
+		delete action;
+		return result;
+	}
+};
+
+}
+
+SUITE(ai) {
+
+TEST(should_chase_seen_player)
+{
+	AIFixture fixture("wander_ant");
+	TempleAI ai(fixture.random);
+	ai.add(TempleAI::MOVE_TO_HIT_PLAYER_IF_SEES)->add(TempleAI::WAIT);
+	ASSERT(fixture.acts_with<Move>(ai));
+}
+
+TEST(should_hit_player_when_near)
+{
+	AIFixture fixture("wander_ant");
+	fixture.monster().pos = Point(2, 2);
+	TempleAI ai(fixture.random);
+	ai.add(TempleAI::HIT_PLAYER_IF_NEAR)->add(TempleAI::WAIT);
+	ASSERT(fixture.acts_with<Swing>(ai));
+}
+
+TEST(should_wander_when_seen_player_is_out_of_reach)
+{
+	AIFixture fixture("wander_ant");
+	fixture.wall_in_monster();
+	TempleAI ai(fixture.random);
+	ai.add(TempleAI::MOVE_TO_HIT_PLAYER_IF_SEES)->add(TempleAI::MOVE_RANDOM);
+	ASSERT(fixture.acts_with<Move>(ai));
+}
+
+TEST(should_wait_when_seen_player_is_out_of_reach)
+{
+	AIFixture fixture("still_ant");
+	fixture.wall_in_monster();
+	TempleAI ai(fixture.random);
+	ai.add(TempleAI::MOVE_TO_HIT_PLAYER_IF_SEES)->add(TempleAI::WAIT);
+	ASSERT(fixture.acts_with<Wait>(ai));
+}
+
+}
@@ -0,0 +1,153 @@
+#include "../backend.h"
+#include "../test.h"
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace {
+
+// Pipe pair: backend writes into one end, test reads what was written.
+struct Pipe {
+	int read_fd, write_fd;
+	Pipe() : read_fd(-1), write_fd(-1)
+	{
+		int fds[2];
+		if(pipe(fds) == 0) {
+			read_fd = fds[0];
+			write_fd = fds[1];
+			fcntl(read_fd, F_SETFL, O_NONBLOCK);
+		}
+	}
+	~Pipe()
+	{
+		close(read_fd);
+		close(write_fd);
+	}
+	std::string drain()
+	{
+		std::string result;
+		char buffer[256];
+		ssize_t size;
+		while((size = read(read_fd, buffer, sizeof(buffer))) > 0) {
+			result.append(buffer, size_t(size));
+		}
+		return result;
+	}
+};
+
+// First frame repaints the whole screen; later ones send only changes.
+void settle(AnsiBackend & backend, Pipe & output)
+{
+	backend.refresh();
+	output.drain();
+}
+
+}
+
+SUITE(backend) {
+
+TEST(framebuffer_should_start_blank)
+{
+	FramebufferBackend backend(10, 3);
+	EQUAL(backend.row(1), std::string(10, ' '));
+}
+
+TEST(framebuffer_should_store_text)
+{
+	FramebufferBackend backend(10, 3);
+	backend.put_text(2, 1, "abc");
+	EQUAL(backend.row(1), "  abc     ");
+	EQUAL(int(backend.get_glyph(3, 1).ch), int('b'));
+}
+
+TEST(framebuffer_should_clip_outside_writes)
+{
+	FramebufferBackend backend(4, 2);
+	backend.put_text(2, 0, "abcdef");
+	backend.put_glyph(-1, 0, Glyph('x'));
+	backend.put_glyph(0, 5, Glyph('x'));
+	EQUAL(backend.dump(), "  ab\n    \n");
+}
+
+TEST(framebuffer_should_clear)
+{
+	FramebufferBackend backend(4, 2);
+	backend.put_text(0, 0, "abcd");
+	backend.clear();
+	EQUAL(backend.row(0), "    ");
+}
+
+TEST(framebuffer_should_count_frames)
+{
+	FramebufferBackend backend(4, 2);
+	backend.refresh();
+	backend.refresh();
+	EQUAL(backend.frames, 2u);
+}
+
+TEST(framebuffer_should_play_scripted_keys)
+{
+	FramebufferBackend backend(4, 2);
+	backend.keys.push_back('a');
+	EQUAL(backend.get_key(), int('a'));
+	EQUAL(backend.get_key(0), int(Backend::NO_KEY));
+	bool hangup = false;
+	try {
+		backend.get_key();
+	} catch(const Backend::Hangup &) {
+		hangup = true;
+	}
+	ASSERT(hangup);
+}
+
+TEST(ansi_should_write_only_changed_cells)
+{
+	Pipe input, output;
+	AnsiBackend backend(input.read_fd, output.write_fd);
+	settle(backend, output);
+
+	backend.put_text(3, 1, "hi");
+	backend.refresh();
+	EQUAL(output.drain(), "\033[2;4H\033[0mhi\033[?25l");
+
+	backend.put_text(3, 1, "ho");
+	backend.refresh();
+	EQUAL(output.drain(), "\033[2;5H\033[0mo\033[?25l");
+}
+
+TEST(ansi_should_not_write_unchanged_frame)
+{
+	Pipe input, output;
+	AnsiBackend backend(input.read_fd, output.write_fd);
+	backend.put_text(0, 0, "x");
+	backend.refresh();
+	output.drain();
+	backend.put_text(0, 0, "x");
+	backend.refresh();
+	EQUAL(output.drain(), "");
+}
+
+TEST(ansi_should_refresh_on_poll_only_after_drawing)
+{
+	Pipe input, output;
+	AnsiBackend backend(input.read_fd, output.write_fd);
+	settle(backend, output);
+	EQUAL(backend.get_key(0), int(Backend::NO_KEY));
+	EQUAL(output.drain(), "");
+	backend.put_text(0, 0, "x");
+	EQUAL(backend.get_key(0), int(Backend::NO_KEY));
+	EQUAL(output.drain(), "\033[1;1H\033[0mx\033[?25l");
+}
+
+TEST(ansi_should_emit_colors_and_cursor)
+{
+	Pipe input, output;
+	AnsiBackend backend(input.read_fd, output.write_fd);
+	settle(backend, output);
+	backend.put_glyph(0, 23, Glyph('@', Color::RED | Glyph::BOLD));
+	backend.move_cursor(79, 23);
+	backend.show_cursor(true);
+	backend.refresh();
+	EQUAL(output.drain(), "\033[24;1H\033[0;31;1m@\033[24;80H\033[?25h");
+}
+
+}
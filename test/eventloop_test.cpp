@@ -0,0 +1,43 @@
+#include "../eventloop.h"
+#include "../backend.h"
+#include "../test.h"
+
+SUITE(eventloop) {
+
+TEST(should_return_plain_key)
+{
+	FramebufferBackend backend(4, 2);
+	EventLoop loop(backend);
+	backend.keys.push_back('x');
+	EQUAL(loop.get_key(), int('x'));
+}
+
+TEST(should_return_lone_escape)
+{
+	FramebufferBackend backend(4, 2);
+	EventLoop loop(backend);
+	backend.keys.push_back(Backend::KEY_ESCAPE);
+	EQUAL(loop.get_key(), int(Backend::KEY_ESCAPE));
+}
+
+TEST(should_return_escape_for_double_escape)
+{
+	FramebufferBackend backend(4, 2);
+	EventLoop loop(backend);
+	backend.keys.push_back(Backend::KEY_ESCAPE);
+	backend.keys.push_back(Backend::KEY_ESCAPE);
+	EQUAL(loop.get_key(), int(Backend::KEY_ESCAPE));
+}
+
+TEST(should_deliver_key_after_escape)
+{
+	FramebufferBackend backend(4, 2);
+	EventLoop loop(backend);
+	backend.keys.push_back(Backend::KEY_ESCAPE);
+	backend.keys.push_back('x');
+	backend.keys.push_back('y');
+	EQUAL(loop.get_key(), int('x'));
+	EQUAL(loop.get_key(), int('y'));
+}
+
+}
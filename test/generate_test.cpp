@@ -0,0 +1,67 @@
+#include "../generate.h"
+#include "../test.h"
+#include <chthon/level.h>
+using namespace Chthon;
+
+namespace {
+
+unsigned count_objects(const Level & level, const std::string & type)
+{
+	unsigned count = 0;
+	foreach(const Object & object, level.objects) {
+		if(object.type->id == type) {
+			++count;
+		}
+	}
+	return count;
+}
+
+}
+
+SUITE(generate) {
+
+TEST(should_bound_room_grid)
+{
+	ASSERT(RoomGrid(3, 3).valid());
+	ASSERT(RoomGrid(RoomGrid::MAX_COLUMNS, RoomGrid::MAX_ROWS).valid());
+	ASSERT(!RoomGrid(RoomGrid::MAX_COLUMNS + 1, 1).valid());
+	ASSERT(!RoomGrid(1, 0x10000).valid());
+	ASSERT(!RoomGrid(0x10000, 0x10000).valid());
+	ASSERT(!RoomGrid(1, 1).valid());
+}
+
+TEST(should_generate_same_level_from_same_seed)
+{
+	LinearDungeon first(nullptr), second(nullptr);
+	first.set_seed(11);
+	second.set_seed(11);
+	EQUAL(first.regenerate_baseline(2).hash, second.regenerate_baseline(2).hash);
+	ASSERT(first.regenerate_baseline(2).cells == second.regenerate_baseline(2).cells);
+	second.set_seed(12);
+	ASSERT(first.regenerate_baseline(2).hash != second.regenerate_baseline(2).hash);
+}
+
+TEST(should_add_loop_corridors_beyond_tree)
+{
+	LinearDungeon game(nullptr);
+	game.set_seed(13);
+	game.grid = RoomGrid(8, 8);
+	Level level;
+	game.generate(level, 2);
+	unsigned rooms = game.grid.room_count();
+	EQUAL(count_objects(level, "closed_door"), 2 * (rooms - 1 + rooms / 6));
+}
+
+TEST(should_not_repeat_monsters_over_large_grid)
+{
+	LinearDungeon game(nullptr);
+	game.set_seed(14);
+	game.grid = RoomGrid(16, 16);
+	Level level;
+	game.generate(level, 2);
+	// Middle templates of level 2 hold 19 monsters, the last one holds 8.
+	ASSERT(level.monsters.size() <= 1 + 19 * 2 + 8);
+	ASSERT(level.monsters.size() > 1 + 19);
+}
+
+}
@@ -0,0 +1,69 @@
+#include "../logbuffer.h"
+#include "../test.h"
+#include <chthon/log.h>
+#include <chthon/format.h>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+SUITE(log) {
+
+TEST(should_keep_lines_of_threads_whole)
+{
+	std::ostringstream out;
+	direct_synchronized_log(out);
+	std::vector<std::thread> threads;
+	for(unsigned i = 0; i < 4; ++i) {
+		threads.push_back(std::thread([i]() {
+			for(unsigned line = 0; line < 200; ++line) {
+				Chthon::log(std::string(40, char('a' + i)));
+			}
+		}));
+	}
+	for(unsigned i = 0; i < threads.size(); ++i) {
+		threads[i].join();
+	}
+	Chthon::direct_log(nullptr);
+	std::istringstream in(out.str());
+	std::string line;
+	unsigned lines = 0;
+	while(std::getline(in, line)) {
+		EQUAL(line, std::string(40, line[0]));
+		++lines;
+	}
+	EQUAL(lines, 800u);
+}
+
+TEST(should_divert_thread_lines_to_its_sink)
+{
+	std::ostringstream out, sink;
+	direct_synchronized_log(out);
+	{
+		LogRedirect redirect(sink);
+		Chthon::log("session");
+	}
+	Chthon::log("main");
+	Chthon::direct_log(nullptr);
+	EQUAL(sink.str(), "session\n");
+	EQUAL(out.str(), "main\n");
+}
+
+TEST(should_pass_sink_on_to_started_thread)
+{
+	std::ostringstream out, sink;
+	direct_synchronized_log(out);
+	{
+		LogRedirect redirect(sink);
+		std::streambuf * session_sink = LogRedirect::current_sink();
+		std::thread loader([session_sink]() {
+			LogRedirect loader_redirect(session_sink);
+			Chthon::log("loader");
+		});
+		loader.join();
+	}
+	Chthon::direct_log(nullptr);
+	EQUAL(sink.str(), "loader\n");
+	EQUAL(out.str(), "");
+}
+
+}
@@ -0,0 +1,31 @@
+#include "../test.h"
+#include <chthon/util.h>
+#include <iostream>
+#include <cstring>
+
+// Runs every registered test, or only suites named on command line.
+int main(int argc, char ** argv)
+{
+	unsigned passed = 0, failed = 0;
+	foreach(const Test::Case & test_case, Test::all_cases()) {
+		bool selected = (argc < 2);
+		for(int i = 1; i < argc; ++i) {
+			selected = selected || strcmp(argv[i], test_case.suite) == 0;
+		}
+		if(!selected) {
+			continue;
+		}
+		try {
+			test_case.function();
+			++passed;
+		} catch(const Test::Failure & failure) {
+			std::cerr << test_case.suite << "." << test_case.name << ": " << failure.message << std::endl;
+			++failed;
+		} catch(const std::exception & e) {
+			std::cerr << test_case.suite << "." << test_case.name << ": exception: " << e.what() << std::endl;
+			++failed;
+		}
+	}
+	std::cout << passed << " passed, " << failed << " failed." << std::endl;
+	return failed == 0 ? 0 : 1;
+}
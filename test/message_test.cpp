@@ -1,33 +1,85 @@
-#include "../message.h"
+#include "../console.h"
+#include "../backend.h"
 #include "../test.h"
+#include <chthon/format.h>
+#include <chthon/game.h>
 
 SUITE(messages) {
 
 TEST(game_should_start_with_empty_messages)
 {
-	Messages messages;
-	ASSERT(messages.messages.empty());
+	FramebufferBackend backend;
+	Console console(backend);
+	ASSERT(console.messages.empty());
 }
 
 TEST(should_accept_only_non_empty_messages)
 {
-	Messages messages;
-	messages.message("");
-	ASSERT(messages.messages.empty());
+	FramebufferBackend backend;
+	Console console(backend);
+	console.message("");
+	ASSERT(console.messages.empty());
 }
 
 TEST(should_add_messages)
 {
-	Messages messages;
-	messages.message("hello");
-	EQUAL(messages.messages.size(), (unsigned)1);
+	FramebufferBackend backend;
+	Console console(backend);
+	console.message("hello");
+	EQUAL(console.messages.size(), size_t(1));
 }
 
 TEST(should_titlecase_messages)
 {
-	Messages messages;
-	messages.message("hello");
-	EQUAL(messages.messages.front(), "Hello");
+	FramebufferBackend backend;
+	Console console(backend);
+	console.message("hello");
+	EQUAL(console.message_text(0), "Hello");
+}
+
+TEST(should_keep_unseen_messages)
+{
+	FramebufferBackend backend;
+	Console console(backend);
+	for(unsigned i = 0; i < Console::MESSAGE_HISTORY * 3; ++i) {
+		console.message(Chthon::format("message {0}", i));
+	}
+	EQUAL(console.messages.size(), size_t(Console::MESSAGE_HISTORY * 3));
+	EQUAL(console.message_text(0), "Message 0");
+}
+
+TEST(should_drop_old_seen_messages_with_their_texts)
+{
+	FramebufferBackend backend;
+	Console console(backend);
+	for(unsigned i = 0; i < Console::MESSAGE_HISTORY * 3; ++i) {
+		console.message(Chthon::format("message {0}", i));
+		console.messages_seen = unsigned(console.messages.size());
+	}
+	ASSERT(console.messages.size() <= size_t(Console::MESSAGE_HISTORY));
+	ASSERT(console.texts.size() <= size_t(Console::MESSAGE_HISTORY));
+	EQUAL(console.messages_seen, unsigned(console.messages.size()));
+	EQUAL(console.message_text(unsigned(console.messages.size() - 1)), Chthon::format("Message {0}", Console::MESSAGE_HISTORY * 3 - 1));
+}
+
+TEST(should_keep_names_of_kept_event_messages)
+{
+	FramebufferBackend backend;
+	Console console(backend);
+	for(unsigned i = 0; i < Console::MESSAGE_HISTORY * 3; ++i) {
+		Chthon::GameEvent e;
+		e.type = (i % 2) ? Chthon::GameEvent::HITS : Chthon::GameEvent::DIED;
+		e.actor.name = Chthon::format("ant {0}", i / 4);
+		e.target.name = "you";
+		e.amount = 0;
+		console.message(e);
+		console.messages_seen = unsigned(console.messages.size());
+	}
+	ASSERT(console.messages.size() <= size_t(Console::MESSAGE_HISTORY));
+	ASSERT(console.names.size() <= size_t(Console::MESSAGE_HISTORY / 4 + 2));
+	unsigned last = Console::MESSAGE_HISTORY * 3 - 1;
+	EQUAL(console.message_text(unsigned(console.messages.size() - 1)), Chthon::format("Ant {0} hits you.", last / 4));
+	EQUAL(console.message_text(unsigned(console.messages.size() - 2)), Chthon::format("Ant {0} died.", (last - 1) / 4));
 }
 
 }
@@ -0,0 +1,63 @@
+#include "../pager.h"
+#include "../generate.h"
+#include "../test.h"
+#include <chthon/level.h>
+#include <fstream>
+using namespace Chthon;
+
+namespace {
+
+std::streamoff file_size(const std::string & filename)
+{
+	std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+	return file.tellg();
+}
+
+}
+
+SUITE(pager) {
+
+TEST(should_reuse_scratch_space_of_paged_in_levels)
+{
+	const std::string scratch = Test::temp_filename("pager.scratch");
+	LinearDungeon game(nullptr);
+	game.set_seed(4);
+	game.create_new_game();
+	game.generate(game.levels[2], 2);
+	game.generate(game.levels[3], 3);
+	game.pager.configure(scratch, 1);
+	game.pager.enforce_budget(game);
+	EQUAL(game.pager.paged_levels().size(), size_t(2));
+	size_t paged_size = game.pager.paged_size(2) + game.pager.paged_size(3);
+	for(int i = 0; i < 50; ++i) {
+		ASSERT(game.pager.page_in(game, game.levels[2], 2));
+		game.pager.enforce_budget(game);
+		EQUAL(game.levels.count(2), size_t(0));
+	}
+	ASSERT(file_size(scratch) <= std::streamoff(2 * paged_size));
+}
+
+TEST(should_keep_pages_intact_when_reusing_space)
+{
+	const std::string scratch = Test::temp_filename("pager_intact.scratch");
+	LinearDungeon game(nullptr);
+	game.set_seed(8);
+	game.create_new_game();
+	game.generate(game.levels[2], 2);
+	game.generate(game.levels[3], 3);
+	game.pager.configure(scratch, 1);
+	game.pager.enforce_budget(game);
+	EQUAL(game.pager.paged_levels().size(), size_t(2));
+	std::string level3;
+	ASSERT(game.pager.read_page(3, level3));
+	for(int i = 0; i < 10; ++i) {
+		ASSERT(game.pager.page_in(game, game.levels[2], 2));
+		game.pager.enforce_budget(game);
+	}
+	std::string data;
+	ASSERT(game.pager.read_page(3, data));
+	ASSERT(data == level3);
+	ASSERT(game.pager.page_in(game, game.levels[3], 3));
+}
+
+}
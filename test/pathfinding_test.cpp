@@ -0,0 +1,103 @@
+#include "../pathfinding.h"
+#include "../generate.h"
+#include "../test.h"
+#include <chthon/level.h>
+using namespace Chthon;
+
+namespace {
+
+// Two rooms, 1..3 and 5..7 columns wide, with a door at (4, 2) between them:
+// #########
+// #...#...#
+// #...+...#
+// #...#...#
+// #########
+Level & make_level(LinearDungeon & game)
+{
+	game.current_level_index = 1;
+	Level & level = game.levels[1];
+	level = Level(9, 5);
+	level.map.fill(Cell(game.cell_types.get("wall")));
+	for(int y = 1; y <= 3; ++y) {
+		for(int x = 1; x <= 7; ++x) {
+			if(x != 4) {
+				level.map.cell(x, y) = Cell(game.cell_types.get("floor"));
+			}
+		}
+	}
+	level.map.cell(4, 2) = Cell(game.cell_types.get("floor"));
+	game.add_object(level, "closed_door", "opened_door").pos(Point(4, 2));
+	return level;
+}
+
+Point walk(const Point & start, const std::vector<Point> & steps)
+{
+	Point pos = start;
+	for(std::vector<Point>::const_reverse_iterator shift = steps.rbegin(); shift != steps.rend(); ++shift) {
+		pos = pos + *shift;
+	}
+	return pos;
+}
+
+}
+
+SUITE(pathfinding) {
+
+TEST(should_split_level_into_regions_by_doors)
+{
+	LinearDungeon game(nullptr);
+	RoomGraph graph;
+	graph.build(make_level(game));
+	EQUAL(graph.region_count(), 2u);
+	EQUAL(graph.door_count(), 1u);
+}
+
+TEST(should_find_path_within_region)
+{
+	LinearDungeon game(nullptr);
+	Level & level = make_level(game);
+	RoomGraph graph;
+	graph.build(level);
+	std::vector<Point> steps = graph.find_path(level, Point(1, 1), Point(3, 3));
+	EQUAL(steps.size(), size_t(2));
+	ASSERT(walk(Point(1, 1), steps) == Point(3, 3));
+}
+
+TEST(should_find_path_through_door)
+{
+	LinearDungeon game(nullptr);
+	Level & level = make_level(game);
+	RoomGraph graph;
+	graph.build(level);
+	std::vector<Point> steps = graph.find_path(level, Point(1, 1), Point(7, 3));
+	EQUAL(steps.size(), size_t(6));
+	ASSERT(walk(Point(1, 1), steps) == Point(7, 3));
+	ASSERT(walk(Point(1, 1), std::vector<Point>(steps.begin() + 3, steps.end())) == Point(4, 2));
+}
+
+TEST(should_not_pass_locked_door)
+{
+	LinearDungeon game(nullptr);
+	Level & level = make_level(game);
+	RoomGraph graph;
+	graph.build(level);
+	level.objects.back().locked = true;
+	EQUAL(graph.find_path(level, Point(1, 1), Point(7, 3)).size(), size_t(0));
+}
+
+TEST(should_rebuild_stale_graph)
+{
+	LinearDungeon game(nullptr);
+	Level & level = make_level(game);
+	TravelPlanner planner;
+	planner.prepare(level, 1);
+	for(int y = 1; y <= 3; ++y) {
+		level.map.cell(2, y) = Cell(game.cell_types.get("wall"));
+	}
+	level.map.cell(2, 3) = Cell(game.cell_types.get("floor"));
+	std::vector<Point> steps = planner.find_path(game, Point(1, 1), Point(3, 1));
+	ASSERT(walk(Point(1, 1), steps) == Point(3, 1));
+	EQUAL(steps.size(), size_t(4));
+}
+
+}
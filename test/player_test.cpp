@@ -0,0 +1,78 @@
+#include "../player.h"
+#include "../console.h"
+#include "../generate.h"
+#include "../memory.h"
+#include "../test.h"
+#include <chthon/level.h>
+#include <chthon/actions.h>
+using namespace Chthon;
+
+namespace {
+
+// Seen room of floor with player in its top left corner.
+struct TravelFixture {
+	FramebufferBackend backend;
+	TempleUI console;
+	PlayerControl * control;
+	LinearDungeon game;
+	TravelFixture()
+		: backend(80, 25), console(backend), control(new PlayerControl(console)), game(control)
+	{
+		game.current_level_index = 1;
+		Level & level = game.levels[1];
+		level = Level(10, 5);
+		level.map.fill(Cell(game.cell_types.get("floor")));
+		for(unsigned i = 0; i < level.map.cells.size(); ++i) {
+			level.map.cells[i].seen_sprite = 1;
+		}
+		game.add_monster(level, "player").pos(Point(1, 1));
+	}
+	Monster & player() { return game.current_level().get_player(); }
+	// Travels to the cell given number of steps to the right.
+	Action * travel_right(unsigned steps)
+	{
+		backend.keys.push_back('x');
+		for(unsigned i = 0; i < steps; ++i) {
+			backend.keys.push_back('l');
+		}
+		backend.keys.push_back('.');
+		return control->act(player(), game);
+	}
+};
+
+}
+
+SUITE(player) {
+
+TEST(should_queue_only_next_travel_step)
+{
+	TravelFixture fixture;
+	Action * first = fixture.travel_right(5);
+	ASSERT(first != nullptr);
+	delete first;
+	EQUAL(fixture.player().plan.size(), size_t(1));
+	delete fixture.control->act(fixture.player(), fixture.game);
+	EQUAL(fixture.player().plan.size(), size_t(1));
+	MemoryReport report;
+	fixture.control->report_memory(report, fixture.game);
+	EQUAL(report.travel.count, 2u);
+}
+
+TEST(should_end_travel_when_plan_is_interrupted)
+{
+	TravelFixture fixture;
+	delete fixture.travel_right(5);
+	Monster & player = fixture.player();
+	while(!player.plan.empty()) {
+		delete player.plan.front();
+		player.plan.pop_front();
+	}
+	fixture.backend.keys.push_back('q');
+	EQUAL(fixture.control->act(player, fixture.game), static_cast<Action*>(nullptr));
+	ASSERT(player.plan.empty());
+	MemoryReport report;
+	fixture.control->report_memory(report, fixture.game);
+	EQUAL(report.travel.count, 0u);
+}
+
+}
@@ -0,0 +1,121 @@
+#include "../recording.h"
+#include "../test.h"
+#include <fstream>
+#include <cstdio>
+
+namespace {
+
+const std::string RECORDING = Test::temp_filename("recording.rec");
+
+// Draws given frames through a recording backend, then plays them back.
+std::string round_trip(const std::vector<std::string> & frames, unsigned width, unsigned height)
+{
+	{
+		Recorder recorder(RECORDING);
+		FramebufferBackend screen(width, height);
+		RecordingBackend backend(screen, recorder);
+		backend.init();
+		for(unsigned i = 0; i < frames.size(); ++i) {
+			backend.clear();
+			backend.put_text(0, 0, frames[i]);
+			backend.put_glyph(int(width) - 1, int(height) - 1, Glyph('@', Color::RED | Glyph::BOLD));
+			backend.refresh();
+		}
+	}
+	FramebufferBackend player(width, height);
+	play_recording(player, RECORDING);
+	remove(RECORDING.c_str());
+	ASSERT(player.get_glyph(int(width) - 1, int(height) - 1) == Glyph('@', Color::RED | Glyph::BOLD));
+	return player.row(0);
+}
+
+}
+
+SUITE(recording) {
+
+TEST(should_play_back_last_frame)
+{
+	std::vector<std::string> frames;
+	frames.push_back("hello");
+	frames.push_back("help");
+	frames.push_back("yellow");
+	EQUAL(round_trip(frames, 8, 2), "yellow  ");
+}
+
+TEST(should_store_wide_screens_as_multibyte_varints)
+{
+	std::vector<std::string> frames;
+	frames.push_back(std::string(200, 'a'));
+	frames.push_back(std::string(150, 'b'));
+	EQUAL(round_trip(frames, 300, 3), std::string(150, 'b') + std::string(150, ' '));
+}
+
+TEST(should_play_back_across_keyframes)
+{
+	std::vector<std::string> frames;
+	for(unsigned i = 0; i < Recorder::KEYFRAME_INTERVAL * 2 + 5; ++i) {
+		frames.push_back(std::string(1 + i % 7, char('a' + i % 26)));
+	}
+	EQUAL(round_trip(frames, 10, 2), frames.back() + std::string(10 - frames.back().size(), ' '));
+}
+
+TEST(should_write_each_frame_once)
+{
+	const unsigned FRAMES = 50;
+	{
+		Recorder recorder(RECORDING);
+		FramebufferBackend screen(10, 2);
+		RecordingBackend backend(screen, recorder);
+		backend.init();
+		for(unsigned i = 0; i < FRAMES; ++i) {
+			backend.put_glyph(int(i % 10), 0, Glyph((unsigned char)('a' + i % 26)));
+			backend.refresh();
+		}
+	}
+	std::ifstream in(RECORDING.c_str(), std::ios::binary | std::ios::ate);
+	std::streamoff size = in.tellg();
+	FramebufferBackend player(10, 2);
+	play_recording(player, RECORDING);
+	remove(RECORDING.c_str());
+	EQUAL(player.frames, FRAMES);
+	// Header, one keyframe and single cell diffs: far below quadratic growth.
+	ASSERT(size < std::streamoff(FRAMES * 16 + 64));
+}
+
+TEST(should_reject_unknown_file)
+{
+	{
+		std::ofstream out(RECORDING.c_str());
+		out << "not a recording";
+	}
+	FramebufferBackend player(10, 2);
+	EQUAL(play_recording(player, RECORDING), 1);
+	remove(RECORDING.c_str());
+}
+
+TEST(should_stop_at_truncated_frame)
+{
+	{
+		Recorder recorder(RECORDING);
+		FramebufferBackend screen(10, 2);
+		RecordingBackend backend(screen, recorder);
+		backend.init();
+		backend.put_text(0, 0, "abc");
+		backend.refresh();
+	}
+	std::string data;
+	{
+		std::ifstream in(RECORDING.c_str(), std::ios::binary);
+		data.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	}
+	{
+		std::ofstream out(RECORDING.c_str(), std::ios::binary);
+		out.write(data.data(), std::streamsize(data.size() - 2));
+	}
+	FramebufferBackend player(10, 2);
+	EQUAL(play_recording(player, RECORDING), 0);
+	EQUAL(player.frames, 0u);
+	remove(RECORDING.c_str());
+}
+
+}
@@ -0,0 +1,66 @@
+#include "../rng.h"
+#include "../test.h"
+#include <set>
+
+SUITE(rng) {
+
+TEST(should_produce_reference_xoshiro128_sequence)
+{
+	Rng rng;
+	rng.state[0] = 1;
+	rng.state[1] = 2;
+	rng.state[2] = 3;
+	rng.state[3] = 4;
+	EQUAL(rng.next(), 11520u);
+	EQUAL(rng.next(), 0u);
+	EQUAL(rng.next(), 5927040u);
+}
+
+TEST(should_reproduce_stream_from_seed)
+{
+	Rng first = Rng::stream(42, 1, 3), second = Rng::stream(42, 1, 3);
+	for(unsigned i = 0; i < 100; ++i) {
+		EQUAL(first.next(), second.next());
+	}
+}
+
+TEST(should_keep_streams_independent)
+{
+	Rng level = Rng::stream(42, 1, 3);
+	uint32_t expected = level.next();
+	Rng other = Rng::stream(42, 2);
+	for(unsigned i = 0; i < 100; ++i) {
+		other.next();
+	}
+	Rng again = Rng::stream(42, 1, 3);
+	EQUAL(again.next(), expected);
+}
+
+TEST(should_derive_different_streams)
+{
+	std::set<uint32_t> firsts;
+	for(unsigned seed = 0; seed < 4; ++seed) {
+		for(unsigned stream_id = 1; stream_id <= 2; ++stream_id) {
+			for(unsigned index = 0; index < 4; ++index) {
+				firsts.insert(Rng::stream(seed, stream_id, index).next());
+			}
+		}
+	}
+	EQUAL(firsts.size(), size_t(4 * 2 * 4));
+}
+
+TEST(should_stay_within_range)
+{
+	Rng rng(7);
+	std::set<unsigned> seen;
+	for(unsigned i = 0; i < 1000; ++i) {
+		unsigned value = rng.range(5u);
+		ASSERT(value < 5);
+		seen.insert(value);
+		int signed_value = rng.range(-2, 2);
+		ASSERT(-2 <= signed_value && signed_value <= 2);
+	}
+	EQUAL(seen.size(), size_t(5));
+}
+
+}
@@ -0,0 +1,204 @@
+#include "../savefile.h"
+#include "../generate.h"
+#include "../test.h"
+#include <chthon/files.h>
+#include <chthon/level.h>
+#include <sstream>
+using namespace Chthon;
+
+namespace {
+
+std::string save_game(const LinearDungeon & game)
+{
+	std::ostringstream out;
+	Writer writer(out);
+	save(writer, game);
+	return out.str();
+}
+
+std::string save_one_level(const LinearDungeon & game, int level_index)
+{
+	std::ostringstream out;
+	Writer writer(out);
+	save_level(writer, game, level_index, game.levels.find(level_index)->second);
+	return out.str();
+}
+
+Point first_wall(const Level & level)
+{
+	for(int y = 0; y < int(level.map.height); ++y) {
+		for(int x = 0; x < int(level.map.width); ++x) {
+			if(level.map.cell(x, y).type->id == "wall") {
+				return Point(x, y);
+			}
+		}
+	}
+	return Point();
+}
+
+}
+
+SUITE(savefile) {
+
+TEST(should_regenerate_level_from_seed_and_apply_delta)
+{
+	LinearDungeon game(nullptr);
+	game.set_seed(42);
+	game.create_new_game();
+	Level & level = game.levels[1];
+	Point dug = first_wall(level);
+	level.map.cell(dug) = Cell(game.cell_types.get("floor"));
+	std::string data = save_game(game);
+
+	LinearDungeon loaded(nullptr);
+	std::istringstream in(data);
+	Reader reader(in);
+	load(reader, loaded);
+	EQUAL(loaded.seed, 42u);
+	const Level & restored = loaded.levels[1];
+	EQUAL(restored.map.width, level.map.width);
+	EQUAL(restored.map.height, level.map.height);
+	EQUAL(restored.map.cell(dug).type->id, std::string("floor"));
+	for(unsigned i = 0; i < level.map.cells.size(); ++i) {
+		EQUAL(restored.map.cells[i].type->id, level.map.cells[i].type->id);
+	}
+	EQUAL(restored.monsters.size(), level.monsters.size());
+	EQUAL(restored.objects.size(), level.objects.size());
+}
+
+TEST(should_store_level_as_delta_only_when_baseline_is_known)
+{
+	LinearDungeon game(nullptr);
+	game.set_seed(7);
+	game.create_new_game();
+	std::string delta = save_one_level(game, 1);
+	game.forget_baselines();
+	std::string full = save_one_level(game, 1);
+	ASSERT(delta.size() < full.size());
+
+	LinearDungeon other(nullptr);
+	other.set_seed(7);
+	Level level;
+	std::istringstream full_in(full);
+	Reader full_reader(full_in);
+	load_level(full_reader, other, 1, level);
+	EQUAL(level.map.width, game.levels[1].map.width);
+
+	bool rejected = false;
+	try {
+		std::istringstream delta_in(delta);
+		Reader delta_reader(delta_in);
+		load_level(delta_reader, other, 1, level);
+	} catch(const Reader::Exception &) {
+		rejected = true;
+	}
+	ASSERT(rejected);
+}
+
+TEST(should_reject_delta_against_different_level)
+{
+	LinearDungeon game(nullptr);
+	game.set_seed(1);
+	game.create_new_game();
+	std::string data = save_one_level(game, 1);
+
+	LinearDungeon other(nullptr);
+	other.set_seed(2);
+	other.regenerate_baseline(1);
+	bool rejected = false;
+	try {
+		Level level;
+		std::istringstream in(data);
+		Reader reader(in);
+		load_level(reader, other, 1, level);
+	} catch(const Reader::Exception &) {
+		rejected = true;
+	}
+	ASSERT(rejected);
+}
+
+TEST(should_store_paged_levels_verbatim)
+{
+	LinearDungeon game(nullptr);
+	game.set_seed(3);
+	game.create_new_game();
+	game.generate(game.levels[2], 2);
+	Point dug = first_wall(game.levels[2]);
+	game.levels[2].map.cell(dug) = Cell(game.cell_types.get("floor"));
+	std::string level_record = save_one_level(game, 2);
+	game.pager.configure(Test::temp_filename("savefile.scratch"), 1);
+	game.pager.enforce_budget(game);
+	EQUAL(game.levels.count(2), size_t(0));
+	std::string data = save_game(game);
+	ASSERT(data.find(level_record) != std::string::npos);
+
+	LinearDungeon loaded(nullptr);
+	std::istringstream in(data);
+	Reader reader(in);
+	load(reader, loaded);
+	EQUAL(loaded.levels.count(2), size_t(1));
+	EQUAL(loaded.levels[2].map.cell(dug).type->id, std::string("floor"));
+}
+
+TEST(should_stack_adjacent_floor_items_within_cell)
+{
+	LinearDungeon game(nullptr);
+	game.set_seed(5);
+	game.create_new_game();
+	Level & level = game.levels[1];
+	level.items.clear();
+	game.add_item(level, "apple").pos(Point(1, 1));
+	game.add_item(level, "apple").pos(Point(1, 1));
+	game.add_item(level, "apple").pos(Point(2, 1));
+	game.add_item(level, "spear").pos(Point(2, 1));
+	game.add_item(level, "apple").pos(Point(2, 1));
+	std::vector<std::vector<unsigned> > stacks = game.stacks.group(level.items, true);
+	EQUAL(stacks.size(), size_t(4));
+	EQUAL(stacks[0].size(), size_t(2));
+
+	LinearDungeon loaded(nullptr);
+	std::istringstream in(save_one_level(game, 1));
+	Reader reader(in);
+	Level restored;
+	loaded.set_seed(5);
+	loaded.regenerate_baseline(1);
+	load_level(reader, loaded, 1, restored);
+	EQUAL(restored.items.size(), size_t(5));
+	for(unsigned i = 0; i < level.items.size(); ++i) {
+		EQUAL(restored.items[i].type->id, level.items[i].type->id);
+		ASSERT(restored.items[i].pos == level.items[i].pos);
+	}
+}
+
+TEST(should_keep_inventory_slots_when_stacking)
+{
+	LinearDungeon game(nullptr);
+	game.set_seed(6);
+	game.create_new_game();
+	Monster & player = game.levels[1].get_player();
+	Inventory & inventory = player.inventory;
+	inventory.items.clear();
+	inventory.insert(Item::Builder(game.item_types.get("apple")).pos(Point(3, 3)));
+	inventory.insert(Item::Builder(game.item_types.get("spear")));
+	inventory.insert(Item::Builder(game.item_types.get("apple")).pos(Point(4, 4)));
+	inventory.insert(Item::Builder(game.item_types.get("apple")));
+	inventory.wielded = 1;
+	EQUAL(game.stacks.stack_slots(inventory, 2).size(), size_t(3));
+	EQUAL(game.stacks.stack_slots(inventory, 1).size(), size_t(1));
+	EQUAL(game.stacks.group(inventory.items, false).size(), size_t(3));
+
+	std::string data = save_game(game);
+	LinearDungeon loaded(nullptr);
+	std::istringstream in(data);
+	Reader reader(in);
+	load(reader, loaded);
+	const Inventory & restored = loaded.levels[1].get_player().inventory;
+	EQUAL(restored.items.size(), inventory.items.size());
+	for(unsigned i = 0; i < inventory.items.size(); ++i) {
+		EQUAL(restored.items[i].type->id, inventory.items[i].type->id);
+	}
+	EQUAL(restored.wielded, 1u);
+	EQUAL(restored.wielded_item().type->id, std::string("spear"));
+}
+
+}
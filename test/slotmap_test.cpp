@@ -0,0 +1,72 @@
+#include "../slotmap.h"
+#include "../players.h"
+#include "../test.h"
+
+SUITE(slotmap) {
+
+TEST(should_keep_values_dense_after_removal)
+{
+	SlotMap<int> map;
+	SlotMap<int>::Handle a = map.insert(1);
+	SlotMap<int>::Handle b = map.insert(2);
+	SlotMap<int>::Handle c = map.insert(3);
+	ASSERT(map.remove(a));
+	EQUAL(map.size(), 2u);
+	EQUAL(*map.get(b), 2);
+	EQUAL(*map.get(c), 3);
+	int sum = 0;
+	for(SlotMap<int>::const_iterator value = map.begin(); value != map.end(); ++value) {
+		sum += *value;
+	}
+	EQUAL(sum, 5);
+	ASSERT(map.handle_at(0) == c);
+}
+
+TEST(should_reject_stale_handle)
+{
+	SlotMap<int> map;
+	SlotMap<int>::Handle old = map.insert(1);
+	ASSERT(map.remove(old));
+	ASSERT(!map.contains(old));
+	ASSERT(map.get(old) == nullptr);
+	ASSERT(!map.remove(old));
+	SlotMap<int>::Handle reused = map.insert(2);
+	EQUAL(reused.index, old.index);
+	ASSERT(reused != old);
+	ASSERT(map.get(old) == nullptr);
+	EQUAL(*map.get(reused), 2);
+}
+
+TEST(should_reject_null_handle)
+{
+	SlotMap<int> map;
+	map.insert(1);
+	SlotMap<int>::Handle handle;
+	ASSERT(handle.null());
+	ASSERT(!map.contains(handle));
+}
+
+TEST(should_let_only_one_player_with_a_name_in)
+{
+	PlayerTable players;
+	PlayerTable::Handle first = players.enter("alice", 1);
+	ASSERT(!first.null());
+	ASSERT(players.enter("alice", 2).null());
+	ASSERT(!players.enter("bob", 3).null());
+	EQUAL(players.size(), 2u);
+}
+
+TEST(should_ignore_player_leaving_twice)
+{
+	PlayerTable players;
+	PlayerTable::Handle alice = players.enter("alice", 1);
+	players.enter("bob", 2);
+	EQUAL(players.leave(alice), 1u);
+	PlayerTable::Handle again = players.enter("alice", 3);
+	ASSERT(!again.null());
+	ASSERT(!players.contains(alice));
+	EQUAL(players.leave(alice), 2u);
+	ASSERT(players.contains(again));
+}
+
+}